@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include "devices/ide.h"
 #include "threads/malloc.h"
+#include "threads/trace.h"
 
 /*! A block device. */
 struct block {
@@ -99,7 +100,9 @@ static void check_sector(struct block *block, block_sector_t sector) {
     per-block device locking is unneeded. */
 void block_read(struct block *block, block_sector_t sector, void *buffer) {
     check_sector(block, sector);
+    trace(TRACE_BLOCK_READ, sector, block->type);
     block->ops->read(block->aux, sector, buffer);
+    trace(TRACE_BLOCK_DONE, sector, 0);
     block->read_cnt++;
 }
 
@@ -112,7 +115,9 @@ void block_write(struct block *block, block_sector_t sector,
                  const void *buffer) {
     check_sector(block, sector);
     ASSERT(block->type != BLOCK_FOREIGN);
+    trace(TRACE_BLOCK_WRITE, sector, block->type);
     block->ops->write(block->aux, sector, buffer);
+    trace(TRACE_BLOCK_DONE, sector, 0);
     block->write_cnt++;
 }
 
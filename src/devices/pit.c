@@ -15,9 +15,6 @@
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /*!< Counter port. */
 /*! @} */
 
-/*! PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /*! Configure the given CHANNEL in the PIT.  In a PC, the PIT's
     three output channels are hooked up like this:
 
@@ -79,3 +76,42 @@ void pit_configure_channel(int channel, int mode, int frequency) {
     intr_set_level(old_level);
 }
 
+/*! Starts CHANNEL counting down from COUNT PIT cycles in mode 0, "interrupt
+    on terminal count": the channel's output goes low now and rises once when
+    the count reaches zero, which for channel 0 raises a single timer
+    interrupt.  A COUNT of 0 is treated as 65536.  The channel keeps counting
+    (and wrapping) afterward, but its output stays high until it is
+    reprogrammed. */
+void pit_start_oneshot(int channel, uint16_t count) {
+    enum intr_level old_level;
+
+    ASSERT(channel == 0 || channel == 2);
+
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, (channel << 6) | 0x30);
+    outb(PIT_PORT_COUNTER(channel), count);
+    outb(PIT_PORT_COUNTER(channel), count >> 8);
+    intr_set_level(old_level);
+}
+
+/*! Returns the number of PIT cycles left in CHANNEL's current count and
+    stores the state of the channel's output line into *OUT.  Uses the
+    read-back command to latch the count and status together. */
+uint16_t pit_read_channel(int channel, bool *out) {
+    enum intr_level old_level;
+    uint8_t status;
+    uint16_t count;
+
+    ASSERT(channel == 0 || channel == 2);
+
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, 0xc0 | (1 << (channel + 1)));
+    status = inb(PIT_PORT_COUNTER(channel));
+    count = inb(PIT_PORT_COUNTER(channel));
+    count |= inb(PIT_PORT_COUNTER(channel)) << 8;
+    intr_set_level(old_level);
+
+    *out = (status & 0x80) != 0;
+    return count;
+}
+
@@ -4,10 +4,16 @@
 #include "devices/kbd.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/process.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
@@ -83,6 +89,7 @@ void shutdown_power_off(void) {
 #endif
 
     print_stats();
+    trace_dump();
 
     printf("Powering off...\n");
     serial_flush();
@@ -106,6 +113,10 @@ void shutdown_power_off(void) {
 static void print_stats(void) {
     timer_print_stats();
     thread_print_stats();
+    palloc_print_stats();
+    kmem_print_stats();
+    lock_print_stats();
+    intr_print_stats();
 #ifdef FILESYS
     block_print_stats();
 #endif
@@ -113,6 +124,7 @@ static void print_stats(void) {
     kbd_print_stats();
 #ifdef USERPROG
     exception_print_stats();
+    process_print_stats();
 #endif
 }
 
@@ -7,11 +7,14 @@
 #include <debug.h>
 #include <inttypes.h>
 #include <round.h>
+#include <seqlock.h>
 #include <stdio.h>
 #include "devices/pit.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/work.h"
 
 #if TIMER_FREQ < 19
 #error 8254 timer requires TIMER_FREQ >= 19
@@ -20,21 +23,93 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/*! Number of timer ticks since OS booted. */
+/*! Number of timer ticks since OS booted.  Updated only with interrupts
+    off, under ticks_seq, so that timer_ticks() can read it without
+    disabling interrupts.
+    @{ */
 static int64_t ticks;
+static struct seqlock ticks_seq;
+/*! @} */
 
 /* The system load average */
 static fp load_avg;
 
-/*! Number of loops per timer tick.  Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+/*! Time stamp counter cycles per second.  Measured by timer_calibrate()
+    unless given by kernel command-line option "-tsc=HZ". */
+uint64_t timer_tsc_hz;
+
+/*! Time stamp counter cycles per timer tick, or 0 until timer_calibrate()
+    has run. */
+static uint64_t tsc_per_tick;
+
+/*! Number of timer ticks over which timer_calibrate() times the TSC. */
+#define CALIBRATE_TICKS 5
+
+/*! Time spent in timer_interrupt() and timer_tick_work(), in CPU cycles.
+    Updated only with interrupts off, under isr_stats_seq.
+    @{ */
+static struct timer_isr_stats isr_stats;
+static struct seqlock isr_stats_seq;
+/*! @} */
+
+/*! Per-tick work deferred out of timer_interrupt().
+    @{ */
+static struct work tick_work;
+static int64_t work_ticks;      /*!< Last tick tick_work has caught up to. */
+/*! @} */
+
+/*! If false (default), the timer interrupts TIMER_FREQ times per second.
+    If true, the periodic tick is stopped while the CPU is idle.
+    Controlled by kernel command-line option "-nohz". */
+bool timer_nohz;
+
+/*! PIT cycles in one timer tick. */
+#define PIT_CYCLES_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/*! Longest idle stretch, in ticks, that fits in the PIT's 16-bit counter. */
+#define NOHZ_MAX_TICKS (UINT16_MAX / PIT_CYCLES_PER_TICK)
+
+/*! Tickless idle state.  While nohz_ticks is nonzero, the PIT is counting
+    down a one-shot interval that ends nohz_ticks ticks after the last tick
+    we took, instead of interrupting every tick.
+    @{ */
+static unsigned nohz_ticks;     /*!< Ticks covered by the one-shot, or 0. */
+static uint16_t nohz_count;     /*!< PIT cycles loaded into the one-shot. */
+static unsigned nohz_phase;     /*!< PIT cycles since the last tick when the
+                                     one-shot was started. */
+static unsigned nohz_residue;   /*!< PIT cycles left over from earlier
+                                     one-shots that were cut short. */
+/*! @} */
+
+/*! Shortest one-shot used for an hrtimer, in PIT cycles (about 8 us).
+    A timer due sooner than this waits out a one-shot this long, so that
+    it fires a little late rather than early. */
+#define HR_MIN_PIT_CYCLES 10
+
+/*! High-resolution timers.  When an armed hrtimer is due before the next
+    tick, the tick is split: the PIT is switched to a one-shot that ends at
+    the hrtimer's expiry, then to another that ends on the tick boundary,
+    where periodic mode resumes in phase with the old ticks.
+    @{ */
+static struct rb_tree hrtimers;         /*!< Armed timers, soonest first. */
+static bool hr_oneshot;         /*!< Is the PIT counting a split tick? */
+static unsigned hr_rest;        /*!< PIT cycles from the end of the one-shot
+                                     to the tick boundary, or 0 if the
+                                     one-shot ends on the boundary. */
+/*! @} */
 
 static intr_handler_func timer_interrupt;
+static void timer_advance(void);
+static work_func timer_tick_work;
+static rb_less_func hrtimer_sooner;
+static void hrtimer_run(void);
+static void hrtimer_program(void);
+static void hrtimer_split(unsigned to_tick, bool stopped);
+static uint64_t ns_to_tsc(int64_t ns);
+static hrtimer_func hrsleep_wake;
+static void hrsleep(int64_t ns);
 static void calculate_load_avg(void);
-static void recalculate_recent_cpu(void);
-static void recalculate_priorities(void);
-static bool too_many_loops(unsigned loops);
-static void busy_wait(int64_t loops);
+static fp recent_cpu_coef(void);
 static void real_time_sleep(int64_t num, int32_t denom);
 static void real_time_delay(int64_t num, int32_t denom);
 
@@ -42,6 +117,8 @@ static void real_time_delay(int64_t num, int32_t denom);
     and registers the corresponding interrupt. */
 void timer_init(void) {
     pit_configure_channel(0, 2, TIMER_FREQ);
+    work_init(&tick_work, timer_tick_work, NULL, WORK_HIGH);
+    rb_init(&hrtimers, hrtimer_sooner, NULL);
     intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -55,36 +132,49 @@ fp get_load_avg(void) {
     return load_avg;
 }
 
-/*! Calibrates loops_per_tick, used to implement brief delays. */
+/*! Calibrates the time stamp counter against the PIT, which clock_ns(),
+    brief delays, and high-resolution timers are based on.  Skipped if the
+    TSC rate was given with "-tsc=HZ". */
 void timer_calibrate(void) {
-    unsigned high_bit, test_bit;
+    int64_t start_ticks;
+    uint64_t start_tsc;
 
     ASSERT(intr_get_level() == INTR_ON);
     printf("Calibrating timer...  ");
 
-    /* Approximate loops_per_tick as the largest power-of-two
-       still less than one timer tick. */
-    loops_per_tick = 1u << 10;
-    while (!too_many_loops (loops_per_tick << 1)) {
-        loops_per_tick <<= 1;
-        ASSERT(loops_per_tick != 0);
+    if (timer_tsc_hz == 0) {
+        /* Count TSC cycles over CALIBRATE_TICKS ticks, starting and ending
+           on a tick boundary. */
+        int64_t now;
+
+        start_ticks = timer_ticks();
+        while (timer_ticks() == start_ticks)
+            continue;
+        start_tsc = rdtsc();
+        start_ticks = timer_ticks();
+        while ((now = timer_ticks()) - start_ticks < CALIBRATE_TICKS)
+            continue;
+        timer_tsc_hz = ((rdtsc() - start_tsc) * TIMER_FREQ
+                        / (now - start_ticks));
     }
+    else
+        printf("(from -tsc) ");
+    tsc_per_tick = timer_tsc_hz / TIMER_FREQ;
+    ASSERT(tsc_per_tick != 0);
 
-    /* Refine the next 8 bits of loops_per_tick. */
-    high_bit = loops_per_tick;
-    for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1) {
-        if (!too_many_loops(high_bit | test_bit))
-            loops_per_tick |= test_bit;
-    }
-
-    printf("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+    printf("%'"PRIu64" TSC cycles/s.\n", timer_tsc_hz);
 }
 
-/*! Returns the number of timer ticks since the OS booted. */
+/*! Returns the number of timer ticks since the OS booted.  Does not
+    disable interrupts, so it may be called from anywhere. */
 int64_t timer_ticks(void) {
-    enum intr_level old_level = intr_disable();
-    int64_t t = ticks;
-    intr_set_level(old_level);
+    unsigned seq;
+    int64_t t;
+
+    do {
+        seq = seqlock_read_begin(&ticks_seq);
+        t = ticks;
+    } while (seqlock_read_retry(&ticks_seq, seq));
     return t;
 }
 
@@ -94,6 +184,29 @@ int64_t timer_elapsed(int64_t then) {
     return timer_ticks() - then;
 }
 
+/*! Returns the number of nanoseconds since the TSC started counting,
+    as measured by the time stamp counter.  Never goes backward.
+    Returns 0 before timer_calibrate() has run. */
+int64_t clock_ns(void) {
+    return clock_cycles_to_ns(rdtsc());
+}
+
+/*! Returns the number of nanoseconds elapsed since THEN, which should be a
+    value once returned by clock_ns(). */
+int64_t clock_elapsed_ns(int64_t then) {
+    return clock_ns() - then;
+}
+
+/*! Converts CYCLES time stamp counter cycles to nanoseconds.  Returns 0
+    before timer_calibrate() has run. */
+int64_t clock_cycles_to_ns(uint64_t cycles) {
+    uint64_t hz = timer_tsc_hz;
+
+    if (tsc_per_tick == 0)
+        return 0;
+    return cycles / hz * 1000000000 + cycles % hz * 1000000000 / hz;
+}
+
 
 /*! Sleeps for approximately TICKS timer ticks.  Interrupts must
     be turned on. */
@@ -152,29 +265,193 @@ void timer_ndelay(int64_t ns) {
     real_time_delay(ns, 1000 * 1000 * 1000);
 }
 
+/*! Copies the timer interrupt handler's statistics into STATS. */
+void timer_get_isr_stats(struct timer_isr_stats *stats) {
+    unsigned seq;
+
+    do {
+        seq = seqlock_read_begin(&isr_stats_seq);
+        *stats = isr_stats;
+    } while (seqlock_read_retry(&isr_stats_seq, seq));
+}
+
+/*! Clears the timer interrupt handler's statistics. */
+void timer_reset_isr_stats(void) {
+    enum intr_level old_level = intr_disable();
+    seqlock_write_begin(&isr_stats_seq);
+    isr_stats.count = 0;
+    isr_stats.cycles = 0;
+    isr_stats.max_cycles = 0;
+    isr_stats.work_count = 0;
+    isr_stats.work_cycles = 0;
+    isr_stats.max_work_cycles = 0;
+    seqlock_write_end(&isr_stats_seq);
+    intr_set_level(old_level);
+}
+
 /*! Prints timer statistics. */
 void timer_print_stats(void) {
-    printf("Timer: %"PRId64" ticks\n", timer_ticks());
+    struct timer_isr_stats stats;
+
+    timer_get_isr_stats(&stats);
+    printf("Timer: %"PRId64" ticks, TSC clock at %"PRId64" ns\n",
+           timer_ticks(), clock_ns());
+    printf("Timer: %"PRId64" interrupts, %"PRId64" ns longest; "
+           "%"PRId64" deferred work runs, %"PRId64" ns longest\n",
+           stats.count, clock_cycles_to_ns(stats.max_cycles),
+           stats.work_count, clock_cycles_to_ns(stats.max_work_cycles));
+}
+
+/*! Called by the idle thread, with interrupts off, just before it halts the
+    CPU.  In tickless mode, replaces the periodic timer interrupt with a
+    single one-shot interrupt at the next tick on which a sleeping thread is
+    due, up to NOHZ_MAX_TICKS ticks away. */
+void timer_idle_enter(void) {
+    bool out;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!timer_nohz || nohz_ticks != 0 || hr_oneshot || !rb_empty(&hrtimers))
+        return;
+
+    int64_t next = threads_next_wake(ticks + NOHZ_MAX_TICKS);
+    if (next - ticks < 2)
+        return;
+
+    /* Start the one-shot so that it ends exactly on the tick boundary, by
+       subtracting the part of the current tick that has already gone by. */
+    nohz_phase = PIT_CYCLES_PER_TICK - pit_read_channel(0, &out);
+    nohz_ticks = next - ticks;
+    nohz_count = nohz_ticks * PIT_CYCLES_PER_TICK - nohz_phase;
+    pit_start_oneshot(0, nohz_count);
+}
+
+/*! Called by the interrupt handler on every external interrupt.  If the
+    timer was in tickless mode, brings `ticks' up to date and restores the
+    periodic timer interrupt.  When the one-shot itself fired, the final tick
+    is left for timer_interrupt() to take as usual. */
+void timer_idle_exit(void) {
+    unsigned elapsed, catch_up;
+    uint16_t left;
+    bool fired;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (nohz_ticks == 0)
+        return;
+
+    left = pit_read_channel(0, &fired);
+    pit_configure_channel(0, 2, TIMER_FREQ);
+
+    if (fired) {
+        catch_up = nohz_ticks - 1;
+    }
+    else {
+        elapsed = nohz_phase + nohz_residue + (nohz_count - left);
+        catch_up = elapsed / PIT_CYCLES_PER_TICK;
+        nohz_residue = elapsed % PIT_CYCLES_PER_TICK;
+    }
+    nohz_ticks = 0;
+
+    while (catch_up-- > 0)
+        timer_advance();
 }
 
 /*! Timer interrupt handler (interrupt service routine - ISR). */
 static void timer_interrupt(struct intr_frame *args UNUSED) {
+    uint64_t start = rdtsc();
+    unsigned rest = 0;
+
+    if (hr_oneshot) {
+        /* A split tick's one-shot ended, either early for an hrtimer or on
+           the tick boundary, where the periodic tick resumes. */
+        hr_oneshot = false;
+        rest = hr_rest;
+        if (rest == 0)
+            pit_configure_channel(0, 2, TIMER_FREQ);
+    }
+    if (rest == 0)
+        timer_advance();
+
+    hrtimer_run();
+    if (rest != 0)
+        hrtimer_split(rest, true);
+    else if (!rb_empty(&hrtimers))
+        hrtimer_program();
+
+    uint64_t cycles = rdtsc() - start;
+    seqlock_write_begin(&isr_stats_seq);
+    isr_stats.count++;
+    isr_stats.cycles += cycles;
+    if (cycles > isr_stats.max_cycles) {
+        isr_stats.max_cycles = cycles;
+    }
+    seqlock_write_end(&isr_stats_seq);
+}
+
+/*! Advances the system clock by one tick, charges the tick to the running
+    thread, and leaves the rest of the tick's work to timer_tick_work(). */
+static void timer_advance(void) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    seqlock_write_begin(&ticks_seq);
     ticks++;
+    seqlock_write_end(&ticks_seq);
     thread_tick();
-    // Recalculating the load average every second and the recent cpu for all
-    // threads
-    // Only necessary for mlfqs.
-    if (get_mlfqs()) {
-        if (timer_ticks() % TIMER_FREQ == 0) {
-            calculate_load_avg();
-            recalculate_recent_cpu();
-        }
-        if (timer_ticks() % 4 == 0) {
-            recalculate_priorities();
+    work_queue(&tick_work);
+}
+
+/*! The part of the timer interrupt that can run with interrupts on: MLFQS
+    bookkeeping and waking sleeping threads.  Runs as deferred work on the
+    interrupted thread's stack, so thread_current() is still the thread the
+    tick was charged to.  Catches up on every tick since it last ran, in
+    case several ticks were queued at once. */
+static void timer_tick_work(void *aux UNUSED) {
+    uint64_t start = rdtsc();
+    int64_t now = timer_ticks();
+    enum intr_level old_level;
+
+    while (work_ticks < now) {
+        work_ticks++;
+
+        // Recalculating the load average and decaying recent cpu every
+        // second, and the running thread's priority every 4 ticks.  Only
+        // the running thread's recent cpu changes between decays, so other
+        // threads only need updating at a decay, which thread.c does with
+        // interrupts on.
+        // Only necessary for mlfqs.
+        if (get_mlfqs()) {
+            if (work_ticks % TIMER_FREQ == 0) {
+                old_level = intr_disable();
+                calculate_load_avg();
+                fp coef = recent_cpu_coef();
+                intr_set_level(old_level);
+                thread_mlfqs_decay(coef);
+            }
+            old_level = intr_disable();
+            if (work_ticks % 4 == 0) {
+                struct thread *t = thread_current();
+                if (!is_idle_thread(t)) {
+                    thread_calculate_priority(t);
+                }
+            }
+            intr_set_level(old_level);
         }
     }
+
     // Waking sleeping threads
-    threads_wake(timer_ticks());
+    old_level = intr_disable();
+    threads_wake(now);
+
+    uint64_t cycles = rdtsc() - start;
+    seqlock_write_begin(&isr_stats_seq);
+    isr_stats.work_count++;
+    isr_stats.work_cycles += cycles;
+    if (cycles > isr_stats.max_work_cycles) {
+        isr_stats.max_work_cycles = cycles;
+    }
+    seqlock_write_end(&isr_stats_seq);
+    intr_set_level(old_level);
 }
 
 /* Recalculates the load average */
@@ -192,61 +469,14 @@ static void calculate_load_avg(void) {
                       int_multiply(threads_weight, ready_threads));
 }
 
-/* Recalculates the recent cpu of all threads */
-static void recalculate_recent_cpu(void) {
-    struct list *all_threads = get_all_list();
-    struct list_elem *i = list_front(all_threads);
-    for (; i != list_tail(all_threads); i = i->next) {
-        fp coef;
-        coef = int_multiply(load_avg, 2);
-        coef = fp_divide(coef, int_add(int_multiply(load_avg, 2), 1));
-        struct thread *t = list_entry(i, struct thread, allelem);
-        if (!is_idle_thread(t)) {
-            t->recent_cpu = fp_multiply(coef, t->recent_cpu);
-            t->recent_cpu = int_add(t->recent_cpu, t->nice);
-        }
-    }
+/* Returns the recent cpu decay coefficient, 2*load_avg / (2*load_avg + 1) */
+static fp recent_cpu_coef(void) {
+    fp coef;
+    coef = int_multiply(load_avg, 2);
+    coef = fp_divide(coef, int_add(int_multiply(load_avg, 2), 1));
+    return coef;
 }
 
-/* Recalculates the priority of all threads */
-static void recalculate_priorities(void) {
-    struct list *all_threads = get_all_list();
-    struct list_elem *i = list_front(all_threads);
-    for (; i != list_tail(all_threads); i = i->next) {
-        struct thread *t = list_entry(i, struct thread, allelem);
-        if (!is_idle_thread(t)) {
-            thread_calculate_priority(t);
-        }
-    }
-}
-
-
-/*! Returns true if LOOPS iterations waits for more than one timer tick,
-    otherwise false. */
-static bool too_many_loops(unsigned loops) {
-    /* Wait for a timer tick. */
-    int64_t start = ticks;
-    while (ticks == start)
-        barrier();
-
-    /* Run LOOPS loops. */
-    start = ticks;
-    busy_wait(loops);
-
-    /* If the tick count changed, we iterated too long. */
-    barrier();
-    return start != ticks;
-}
-
-/*! Iterates through a simple loop LOOPS times, for implementing brief delays.
-
-    Marked NO_INLINE because code alignment can significantly affect timings,
-    so that if this function was inlined differently in different places the
-    results would be difficult to predict. */
-static void NO_INLINE busy_wait(int64_t loops) {
-    while (loops-- > 0)
-        barrier();
-}
 
 /*! Sleep for approximately NUM/DENOM seconds. */
 static void real_time_sleep(int64_t num, int32_t denom) {
@@ -264,17 +494,192 @@ static void real_time_sleep(int64_t num, int32_t denom) {
            because it will yield the CPU to other processes. */
         timer_sleep(ticks);
     }
+    else if (tsc_per_tick != 0) {
+        /* Otherwise, block on a high-resolution timer for more accurate
+           sub-tick timing. */
+        ASSERT(denom % 1000 == 0);
+        hrsleep(num * 1000000 / (denom / 1000));
+    }
     else {
-        /* Otherwise, use a busy-wait loop for more accurate sub-tick timing. */
+        /* Before calibration, all we can do is busy-wait. */
         real_time_delay(num, denom);
     }
 }
 
-/*! Busy-wait for approximately NUM/DENOM seconds. */
+/*! Busy-wait for approximately NUM/DENOM seconds, by spinning on the time
+    stamp counter.  Returns at once before timer_calibrate() has run. */
 static void real_time_delay(int64_t num, int32_t denom) {
-    /* Scale the numerator and denominator down by 1000 to avoid
-       the possibility of overflow. */
+    uint64_t end;
+
     ASSERT(denom % 1000 == 0);
-    busy_wait(loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+    end = rdtsc() + ns_to_tsc(num * 1000000 / (denom / 1000));
+    while (rdtsc() < end)
+        barrier();
+}
+
+
+/*! Initializes TIMER to call FUNC(TIMER, AUX) when it expires. */
+void hrtimer_init(struct hrtimer *timer, hrtimer_func *func, void *aux) {
+    ASSERT(timer != NULL);
+    ASSERT(func != NULL);
+
+    timer->func = func;
+    timer->aux = aux;
+    timer->armed = false;
+}
+
+/*! Arms TIMER to expire NS nanoseconds from now, replacing any earlier
+    expiry.  Its function is called from the timer interrupt, so it must
+    not sleep.  Requires timer_calibrate() to have run. */
+void hrtimer_start(struct hrtimer *timer, int64_t ns) {
+    enum intr_level old_level;
+
+    ASSERT(tsc_per_tick != 0);
+
+    old_level = intr_disable();
+    if (timer->armed)
+        rb_remove(&hrtimers, &timer->elem);
+    timer->expires = rdtsc() + ns_to_tsc(ns);
+    timer->armed = true;
+    rb_insert(&hrtimers, &timer->elem);
+    if (rb_min(&hrtimers) == &timer->elem)
+        hrtimer_program();
+    intr_set_level(old_level);
+}
+
+/*! Disarms TIMER.  Returns true if it was armed, false if it had already
+    expired or was never started. */
+bool hrtimer_cancel(struct hrtimer *timer) {
+    enum intr_level old_level = intr_disable();
+    bool was_armed = timer->armed;
+
+    if (was_armed) {
+        rb_remove(&hrtimers, &timer->elem);
+        timer->armed = false;
+    }
+    intr_set_level(old_level);
+    return was_armed;
 }
 
+/*! Orders hrtimers by expiry, soonest first. */
+static bool hrtimer_sooner(const struct rb_elem *a_, const struct rb_elem *b_,
+                           void *aux UNUSED) {
+    const struct hrtimer *a = rb_entry(a_, struct hrtimer, elem);
+    const struct hrtimer *b = rb_entry(b_, struct hrtimer, elem);
+
+    return a->expires < b->expires;
+}
+
+/*! Calls the functions of all the hrtimers that have expired.  Called
+    from the timer interrupt, which then programs the PIT for any that
+    are still to come. */
+static void hrtimer_run(void) {
+    while (!rb_empty(&hrtimers)) {
+        struct hrtimer *timer = rb_entry(rb_min(&hrtimers), struct hrtimer,
+                                         elem);
+        if (timer->expires > rdtsc())
+            break;
+
+        rb_remove(&hrtimers, &timer->elem);
+        timer->armed = false;
+        timer->func(timer, timer->aux);
+    }
+}
+
+/*! Programs the PIT for the soonest hrtimer, given that the PIT is
+    counting toward the next tick, periodically or in a split tick.
+    Interrupts must be off. */
+static void hrtimer_program(void) {
+    unsigned to_tick;
+    bool out;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    /* While the idle thread has the periodic tick stopped, the next
+       external interrupt restores it and lands back here. */
+    if (nohz_ticks != 0)
+        return;
+
+    to_tick = pit_read_channel(0, &out);
+    if (hr_oneshot) {
+        /* If the one-shot has already ended, its interrupt is pending and
+           will reprogram the PIT itself. */
+        if (out)
+            return;
+        to_tick += hr_rest;
+    }
+    else {
+        /* Likewise if a periodic tick has fired since interrupts went off.
+           Splitting now would make its interrupt look like the end of the
+           one-shot, and the tick would be lost.  The count was read first,
+           so a tick that fires after this check leaves it near zero, too
+           close to the boundary to split. */
+        if (intr_pending(0x20))
+            return;
+        if (to_tick == 0)
+            to_tick = PIT_CYCLES_PER_TICK;
+    }
+    hrtimer_split(to_tick, false);
+}
+
+/*! Given that the next tick is TO_TICK PIT cycles away, starts a one-shot
+    that ends at the soonest hrtimer's expiry if that comes first.
+    Otherwise, if STOPPED is true, which means that an early one-shot has
+    just ended, starts one that ends on the tick boundary; if STOPPED is
+    false, leaves the PIT as it is. */
+static void hrtimer_split(unsigned to_tick, bool stopped) {
+    unsigned delay = to_tick;
+    uint64_t now;
+
+    if (!rb_empty(&hrtimers)) {
+        struct hrtimer *timer = rb_entry(rb_min(&hrtimers), struct hrtimer,
+                                         elem);
+        now = rdtsc();
+        if (timer->expires <= now)
+            delay = 0;
+        else if (timer->expires - now < tsc_per_tick)
+            delay = ((timer->expires - now) * PIT_CYCLES_PER_TICK
+                     + tsc_per_tick - 1) / tsc_per_tick;
+        if (delay < HR_MIN_PIT_CYCLES)
+            delay = HR_MIN_PIT_CYCLES;
+    }
+
+    if (delay + HR_MIN_PIT_CYCLES < to_tick) {
+        hr_oneshot = true;
+        hr_rest = to_tick - delay;
+        pit_start_oneshot(0, delay);
+    }
+    else if (stopped) {
+        hr_oneshot = true;
+        hr_rest = 0;
+        pit_start_oneshot(0, to_tick);
+    }
+}
+
+/*! Converts NS nanoseconds to time stamp counter cycles. */
+static uint64_t ns_to_tsc(int64_t ns) {
+    uint64_t hz = timer_tsc_hz;
+
+    if (ns <= 0 || tsc_per_tick == 0)
+        return 0;
+    return ns / 1000000000 * hz + ns % 1000000000 * hz / 1000000000;
+}
+
+/*! Wakes the thread sleeping in hrsleep() on the semaphore SEMA_. */
+static void hrsleep_wake(struct hrtimer *timer UNUSED, void *sema_) {
+    struct semaphore *sema = sema_;
+
+    sema_up(sema);
+}
+
+/*! Blocks the running thread for NS nanoseconds on a high-resolution
+    timer. */
+static void hrsleep(int64_t ns) {
+    struct hrtimer timer;
+    struct semaphore sema;
+
+    sema_init(&sema, 0);
+    hrtimer_init(&timer, hrsleep_wake, &sema);
+    hrtimer_start(&timer, ns);
+    sema_down(&sema);
+}
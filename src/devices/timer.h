@@ -1,13 +1,23 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <rbtree.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include "lib/kernel/fixed_point.h"
 
 /*! Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/*! If true, stop the periodic timer interrupt while idle.
+    Controlled by kernel command-line option "-nohz". */
+extern bool timer_nohz;
+
+/*! Time stamp counter cycles per second.  Measured by timer_calibrate()
+    unless given by kernel command-line option "-tsc=HZ". */
+extern uint64_t timer_tsc_hz;
+
 void init_load_avg(void);
 
 fp get_load_avg(void);
@@ -18,6 +28,11 @@ void timer_calibrate(void);
 int64_t timer_ticks(void);
 int64_t timer_elapsed(int64_t);
 
+/* Monotonic nanosecond clock, from the time stamp counter. */
+int64_t clock_ns(void);
+int64_t clock_elapsed_ns(int64_t);
+int64_t clock_cycles_to_ns(uint64_t cycles);
+
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep(int64_t ticks);
 void timer_msleep(int64_t milliseconds);
@@ -29,6 +44,44 @@ void timer_mdelay(int64_t milliseconds);
 void timer_udelay(int64_t microseconds);
 void timer_ndelay(int64_t nanoseconds);
 
+/* High-resolution timers. */
+struct hrtimer;
+
+/*! Function called, from the timer interrupt, when TIMER expires. */
+typedef void hrtimer_func(struct hrtimer *timer, void *aux);
+
+/*! A high-resolution timer.  Expires at a given time stamp counter value,
+    accurate to a few microseconds rather than to a timer tick. */
+struct hrtimer {
+    struct rb_elem elem;        /*!< Element in the queue of armed timers. */
+    uint64_t expires;           /*!< TSC value at which to expire. */
+    hrtimer_func *func;         /*!< Function to call on expiry. */
+    void *aux;                  /*!< Argument for FUNC. */
+    bool armed;                 /*!< In the queue? */
+};
+
+void hrtimer_init(struct hrtimer *, hrtimer_func *, void *aux);
+void hrtimer_start(struct hrtimer *, int64_t ns);
+bool hrtimer_cancel(struct hrtimer *);
+
+/*! Time spent in the timer interrupt handler, and in the work it defers
+    to run with interrupts on (see threads/work.h). */
+struct timer_isr_stats {
+    int64_t count;              /*!< Number of timer interrupts handled. */
+    uint64_t cycles;            /*!< Total CPU cycles spent handling them. */
+    uint64_t max_cycles;        /*!< Longest single interrupt, in cycles. */
+    int64_t work_count;         /*!< Number of runs of the deferred work. */
+    uint64_t work_cycles;       /*!< Total CPU cycles spent in it. */
+    uint64_t max_work_cycles;   /*!< Longest single run, in cycles. */
+};
+
+void timer_get_isr_stats(struct timer_isr_stats *);
+void timer_reset_isr_stats(void);
+
+/* Tickless idle. */
+void timer_idle_enter(void);
+void timer_idle_exit(void);
+
 void timer_print_stats(void);
 
 #endif /* devices/timer.h */
@@ -4,7 +4,7 @@
 #include <list.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 /*! A directory. */
 struct dir {
@@ -12,6 +12,9 @@ struct dir {
     off_t pos;                          /*!< Current position. */
 };
 
+/*! Cache of `struct dir's. */
+static struct kmem_cache *dir_cache;
+
 /*! A single directory entry. */
 struct dir_entry {
     block_sector_t inode_sector;        /*!< Sector number of header. */
@@ -19,6 +22,13 @@ struct dir_entry {
     bool in_use;                        /*!< In use or free? */
 };
 
+/*! Initializes the directory module. */
+void dir_init(void) {
+    dir_cache = kmem_cache_create("dir", sizeof(struct dir), NULL);
+    if (dir_cache == NULL)
+        PANIC("directory cache creation failed");
+}
+
 /*! Creates a directory with space for ENTRY_CNT entries in the
     given SECTOR.  Returns true if successful, false on failure. */
 bool dir_create(block_sector_t sector, size_t entry_cnt) {
@@ -28,15 +38,14 @@ bool dir_create(block_sector_t sector, size_t entry_cnt) {
 /*! Opens and returns the directory for the given INODE, of which
     it takes ownership.  Returns a null pointer on failure. */
 struct dir * dir_open(struct inode *inode) {
-    struct dir *dir = calloc(1, sizeof(*dir));
-    if (inode != NULL && dir != NULL) {
+    struct dir *dir = inode != NULL ? kmem_cache_alloc(dir_cache) : NULL;
+    if (dir != NULL) {
         dir->inode = inode;
         dir->pos = 0;
         return dir;
     }
     else {
         inode_close(inode);
-        free(dir);
         return NULL; 
     }
 }
@@ -57,7 +66,7 @@ struct dir * dir_reopen(struct dir *dir) {
 void dir_close(struct dir *dir) {
     if (dir != NULL) {
         inode_close(dir->inode);
-        free(dir);
+        kmem_cache_free(dir_cache, dir);
     }
 }
 
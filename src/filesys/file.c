@@ -1,7 +1,7 @@
 #include "filesys/file.h"
 #include <debug.h>
 #include "filesys/inode.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 /*! An open file. */
 struct file {
@@ -10,12 +10,22 @@ struct file {
     bool deny_write;            /*!< Has file_deny_write() been called? */
 };
 
+/*! Cache of `struct file's. */
+static struct kmem_cache *file_cache;
+
+/*! Initializes the file module. */
+void file_init(void) {
+    file_cache = kmem_cache_create("file", sizeof (struct file), NULL);
+    if (file_cache == NULL)
+        PANIC("file cache creation failed");
+}
+
 /*! Opens a file for the given INODE, of which it takes ownership,
     and returns the new file.  Returns a null pointer if an
     allocation fails or if INODE is null. */
 struct file * file_open(struct inode *inode) {
-    struct file *file = calloc(1, sizeof *file);
-    if (inode != NULL && file != NULL) {
+    struct file *file = inode != NULL ? kmem_cache_alloc(file_cache) : NULL;
+    if (file != NULL) {
         file->inode = inode;
         file->pos = 0;
         file->deny_write = false;
@@ -23,7 +33,6 @@ struct file * file_open(struct inode *inode) {
     }
     else {
         inode_close(inode);
-        free(file);
         return NULL; 
     }
 }
@@ -39,7 +48,7 @@ void file_close(struct file *file) {
     if (file != NULL) {
         file_allow_write(file);
         inode_close(file->inode);
-        free(file); 
+        kmem_cache_free(file_cache, file);
     }
 }
 
@@ -22,7 +22,7 @@ void free_map_init(void) {
     Returns true if successful, false if not enough consecutive sectors were
     available or if the free_map file could not be written. */
 bool free_map_allocate(size_t cnt, block_sector_t *sectorp) {
-    block_sector_t sector = bitmap_scan_and_flip(free_map, 0, cnt, false);
+    block_sector_t sector = bitmap_scan_and_flip_next(free_map, cnt, false);
     if (sector != BITMAP_ERROR && free_map_file != NULL &&
         !bitmap_write(free_map, free_map_file)) {
         bitmap_set_multiple(free_map, sector, cnt, false); 
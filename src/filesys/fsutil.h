@@ -1,6 +1,16 @@
 #ifndef FILESYS_FSUTIL_H
 #define FILESYS_FSUTIL_H
 
+#include <stdbool.h>
+
+/*! If true, fsutil_extract() reads ahead on the worker pool.  Controlled by
+    kernel command-line option "-pool-extract". */
+extern bool fsutil_pool_extract;
+
+/*! If true, fsutil_extract() reports how long it took.  Controlled by kernel
+    command-line option "-time-extract". */
+extern bool fsutil_time_extract;
+
 void fsutil_ls(char **argv);
 void fsutil_cat(char **argv);
 void fsutil_rm(char **argv);
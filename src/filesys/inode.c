@@ -6,6 +6,7 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
 /*! Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -51,9 +52,15 @@ static block_sector_t byte_to_sector(const struct inode *inode, off_t pos) {
     returns the same `struct inode'. */
 static struct list open_inodes;
 
+/*! Cache of `struct inode's, which malloc() would round up to 1 kB. */
+static struct kmem_cache *inode_cache;
+
 /*! Initializes the inode module. */
 void inode_init(void) {
     list_init(&open_inodes);
+    inode_cache = kmem_cache_create("inode", sizeof (struct inode), NULL);
+    if (inode_cache == NULL)
+        PANIC("inode cache creation failed");
 }
 
 /*! Initializes an inode with LENGTH bytes of data and
@@ -110,7 +117,7 @@ struct inode * inode_open(block_sector_t sector) {
     }
 
     /* Allocate memory. */
-    inode = malloc(sizeof *inode);
+    inode = kmem_cache_alloc(inode_cache);
     if (inode == NULL)
         return NULL;
 
@@ -156,7 +163,7 @@ void inode_close(struct inode *inode) {
                              bytes_to_sectors(inode->data.length)); 
         }
 
-        free(inode); 
+        kmem_cache_free(inode_cache, inode);
     }
 }
 
@@ -27,6 +27,7 @@ typedef unsigned long elem_type;
 struct bitmap
   {
     size_t bit_cnt;     /* Number of bits. */
+    size_t hint;        /* Where bitmap_scan_and_flip_next() starts. */
     elem_type *bits;    /* Elements that represent bits. */
   };
 
@@ -53,6 +54,40 @@ elem_cnt (size_t bit_cnt)
   return DIV_ROUND_UP (bit_cnt, ELEM_BITS);
 }
 
+/* Returns a mask of the bits in element ELEM_IDX that represent
+   bits START through END, exclusive, of the bitmap. */
+static inline elem_type
+range_mask (size_t elem_idx, size_t start, size_t end)
+{
+  elem_type mask = (elem_type) -1;
+  if (start > elem_idx * ELEM_BITS)
+    mask &= ~(bit_mask (start) - 1);
+  if (end < (elem_idx + 1) * ELEM_BITS)
+    mask &= bit_mask (end) - 1;
+  return mask;
+}
+
+/* Returns the index of the least significant 1-bit in X, which
+   must be nonzero.  See the description of the BSF instruction
+   in [IA32-v2a]. */
+static inline size_t
+bsf (elem_type x)
+{
+  elem_type idx;
+  asm ("bsfl %1, %0" : "=r" (idx) : "rm" (x) : "cc");
+  return idx;
+}
+
+/* Returns the number of 1-bits in X. */
+static inline size_t
+popcount (elem_type x)
+{
+  x = x - ((x >> 1) & 0x55555555);
+  x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+  x = (x + (x >> 4)) & 0x0f0f0f0f;
+  return (x * 0x01010101) >> 24;
+}
+
 /* Returns the number of bytes required for BIT_CNT bits. */
 static inline size_t
 byte_cnt (size_t bit_cnt)
@@ -82,6 +117,7 @@ bitmap_create (size_t bit_cnt)
   if (b != NULL)
     {
       b->bit_cnt = bit_cnt;
+      b->hint = 0;
       b->bits = malloc (byte_cnt (bit_cnt));
       if (b->bits != NULL || bit_cnt == 0)
         {
@@ -104,6 +140,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
   ASSERT (block_size >= bitmap_buf_size (bit_cnt));
 
   b->bit_cnt = bit_cnt;
+  b->hint = 0;
   b->bits = (elem_type *) (b + 1);
   bitmap_set_all (b, false);
   return b;
@@ -217,14 +254,24 @@ bitmap_set_all (struct bitmap *b, bool value)
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t end = start + cnt;
+  size_t idx;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
-  ASSERT (start + cnt <= b->bit_cnt);
+  ASSERT (end <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  /* Each element is updated with a single OR or AND, which is
+     atomic on a uniprocessor machine, as in bitmap_mark() and
+     bitmap_reset(). */
+  for (idx = elem_idx (start); idx * ELEM_BITS < end; idx++) 
+    {
+      elem_type mask = range_mask (idx, start, end);
+      if (value)
+        asm ("orl %1, %0" : "+m" (b->bits[idx]) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "+m" (b->bits[idx]) : "r" (~mask) : "cc");
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -232,17 +279,43 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i, value_cnt;
+  size_t end = start + cnt;
+  size_t idx, true_cnt;
 
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
-  ASSERT (start + cnt <= b->bit_cnt);
+  ASSERT (end <= b->bit_cnt);
+
+  true_cnt = 0;
+  for (idx = elem_idx (start); idx * ELEM_BITS < end; idx++)
+    true_cnt += popcount (b->bits[idx] & range_mask (idx, start, end));
+  return value ? true_cnt : cnt - true_cnt;
+}
+
+/* Returns the index of the first bit in B at or after START, and
+   before END, that is set to VALUE, or END if there is none.
+   Skips over whole elements that contain no such bit. */
+static size_t
+find_next (const struct bitmap *b, size_t start, size_t end, bool value) 
+{
+  elem_type invert = value ? 0 : (elem_type) -1;
+  size_t idx = elem_idx (start);
+  elem_type bits;
+
+  if (start >= end)
+    return end;
 
-  value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
-  return value_cnt;
+  /* Turn the bits we are looking for into 1s, and ignore those
+     before START. */
+  bits = (b->bits[idx] ^ invert) & ~(bit_mask (start) - 1);
+  while (bits == 0) 
+    {
+      if (++idx * ELEM_BITS >= end)
+        return end;
+      bits = b->bits[idx] ^ invert;
+    }
+  start = idx * ELEM_BITS + bsf (bits);
+  return start < end ? start : end;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -250,16 +323,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return find_next (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -288,6 +356,33 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 
 /* Finding set or unset bits. */
 
+/* Finds and returns the starting index of the first group of CNT
+   consecutive bits in B at or after START, and ending at or
+   before END, that are all set to VALUE.
+   If there is no such group, returns BITMAP_ERROR. */
+static size_t
+scan (const struct bitmap *b, size_t start, size_t end, size_t cnt,
+      bool value) 
+{
+  while (cnt <= end && start <= end - cnt) 
+    {
+      size_t stop;
+
+      /* Skip the run of !VALUE bits at START, if any, then the run
+         of VALUE bits that follows.  If the latter is long
+         enough, we're done; otherwise the bit that ends it rules
+         out every start position up to and including itself. */
+      start = find_next (b, start, end - cnt + 1, value);
+      if (start > end - cnt)
+        break;
+      stop = find_next (b, start, start + cnt, !value);
+      if (stop == start + cnt)
+        return start;
+      start = stop + 1;
+    }
+  return BITMAP_ERROR;
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
@@ -298,15 +393,9 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
-    {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
-    }
-  return BITMAP_ERROR;
+  if (cnt == 0)
+    return start;
+  return scan (b, start, b->bit_cnt, cnt, value);
 }
 
 /* Finds the first group of CNT consecutive bits in B at or after
@@ -324,7 +413,63 @@ bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value)
     bitmap_set_multiple (b, idx, cnt, !value);
   return idx;
 }
-
+
+/* Like bitmap_scan_and_flip(), but "next fit": the search starts
+   where the group found by the previous call on B ended, and
+   wraps around to the beginning of B if necessary, so that
+   repeated allocations do not rescan the bits at the start of B
+   that they have already used up.
+   If CNT is zero, returns the starting position. */
+size_t
+bitmap_scan_and_flip_next (struct bitmap *b, size_t cnt, bool value)
+{
+  ASSERT (b != NULL);
+
+  return bitmap_scan_and_flip_next_limit (b, cnt, b->bit_cnt, value);
+}
+
+/* Like bitmap_scan_and_flip_next(), but tries no more than
+   LIMIT starting positions, for callers that must bound how long
+   the search takes.  If it finds no group, the next search
+   starts where this one left off, so that repeated calls
+   eventually cover all of B. */
+size_t
+bitmap_scan_and_flip_next_limit (struct bitmap *b, size_t cnt, size_t limit,
+                                 bool value)
+{
+  size_t start, end, idx;
+
+  ASSERT (b != NULL);
+
+  start = b->hint;
+  if (cnt == 0)
+    return start;
+  if (limit > b->bit_cnt)
+    limit = b->bit_cnt;
+
+  /* Search from START toward the end, then wrap around to the
+     beginning for whatever part of LIMIT is left, stopping short
+     of the groups that the first search covered. */
+  end = start + limit + cnt - 1 < b->bit_cnt ? start + limit + cnt - 1
+                                             : b->bit_cnt;
+  idx = scan (b, start, end, cnt, value);
+  if (idx == BITMAP_ERROR && start + limit > b->bit_cnt) 
+    {
+      end = start + limit - b->bit_cnt + cnt - 1;
+      if (end > b->bit_cnt)
+        end = b->bit_cnt;
+      idx = scan (b, 0, end, cnt, value);
+    }
+  if (idx != BITMAP_ERROR) 
+    {
+      bitmap_set_multiple (b, idx, cnt, !value);
+      b->hint = idx + cnt;
+    }
+  else if (b->bit_cnt > 0)
+    b->hint = (start + limit) % b->bit_cnt;
+  return idx;
+}
+
 /* File input and output. */
 
 #ifdef FILESYS
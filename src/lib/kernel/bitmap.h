@@ -36,6 +36,9 @@ bool bitmap_all (const struct bitmap *, size_t start, size_t cnt);
 #define BITMAP_ERROR SIZE_MAX
 size_t bitmap_scan (const struct bitmap *, size_t start, size_t cnt, bool);
 size_t bitmap_scan_and_flip (struct bitmap *, size_t start, size_t cnt, bool);
+size_t bitmap_scan_and_flip_next (struct bitmap *, size_t cnt, bool);
+size_t bitmap_scan_and_flip_next_limit (struct bitmap *, size_t cnt,
+                                        size_t limit, bool);
 
 /* File input and output. */
 #ifdef FILESYS
@@ -0,0 +1,340 @@
+/* Red-black tree.
+
+   See rbtree.h for basic information.  The algorithms are those
+   of [CLRS] chapter 13, adapted to use null pointers instead of
+   a sentinel for the leaves. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void replace_child (struct rb_tree *, struct rb_elem *parent,
+                           struct rb_elem *old, struct rb_elem *new);
+static void remove_fixup (struct rb_tree *, struct rb_elem *x,
+                          struct rb_elem *parent);
+
+/* Returns true if E is a red node.  Null leaves are black. */
+static inline bool
+is_red (const struct rb_elem *e) 
+{
+  return e != NULL && e->red;
+}
+
+/* Initializes T as an empty tree ordered by LESS given auxiliary
+   data AUX. */
+void
+rb_init (struct rb_tree *t, rb_less_func *less, void *aux) 
+{
+  ASSERT (t != NULL);
+  ASSERT (less != NULL);
+
+  t->root = NULL;
+  t->min = NULL;
+  t->elem_cnt = 0;
+  t->less = less;
+  t->aux = aux;
+}
+
+/* Inserts E into T.  E is placed after any elements that
+   compare equal to it. */
+void
+rb_insert (struct rb_tree *t, struct rb_elem *e) 
+{
+  struct rb_elem *parent = NULL;
+  struct rb_elem **link = &t->root;
+  bool leftmost = true;
+
+  ASSERT (t != NULL);
+  ASSERT (e != NULL);
+
+  /* Ordinary binary search tree insertion. */
+  while (*link != NULL) 
+    {
+      parent = *link;
+      if (t->less (e, parent, t->aux))
+        link = &parent->left;
+      else 
+        {
+          link = &parent->right;
+          leftmost = false;
+        }
+    }
+  e->parent = parent;
+  e->left = e->right = NULL;
+  e->red = true;
+  *link = e;
+  if (leftmost)
+    t->min = e;
+  t->elem_cnt++;
+
+  /* Restore the red-black properties. */
+  while (is_red (e->parent)) 
+    {
+      struct rb_elem *p = e->parent;
+      struct rb_elem *g = p->parent;
+
+      if (p == g->left) 
+        {
+          struct rb_elem *u = g->right;
+          if (is_red (u)) 
+            {
+              p->red = u->red = false;
+              g->red = true;
+              e = g;
+            }
+          else 
+            {
+              if (e == p->right) 
+                {
+                  rotate_left (t, p);
+                  e = p;
+                  p = e->parent;
+                }
+              p->red = false;
+              g->red = true;
+              rotate_right (t, g);
+            }
+        }
+      else 
+        {
+          struct rb_elem *u = g->left;
+          if (is_red (u)) 
+            {
+              p->red = u->red = false;
+              g->red = true;
+              e = g;
+            }
+          else 
+            {
+              if (e == p->left) 
+                {
+                  rotate_right (t, p);
+                  e = p;
+                  p = e->parent;
+                }
+              p->red = false;
+              g->red = true;
+              rotate_left (t, g);
+            }
+        }
+    }
+  t->root->red = false;
+}
+
+/* Removes E, which must be in T, from T. */
+void
+rb_remove (struct rb_tree *t, struct rb_elem *e) 
+{
+  struct rb_elem *y, *x, *x_parent;
+  bool y_red;
+
+  ASSERT (t != NULL);
+  ASSERT (e != NULL);
+  ASSERT (t->elem_cnt > 0);
+
+  if (t->min == e)
+    t->min = rb_next (e);
+  t->elem_cnt--;
+
+  /* Y is the node that is actually unlinked from its position:
+     E itself if it has at most one child, otherwise E's
+     successor, which then takes E's place. */
+  if (e->left == NULL || e->right == NULL)
+    y = e;
+  else 
+    {
+      y = e->right;
+      while (y->left != NULL)
+        y = y->left;
+    }
+
+  x = y->left != NULL ? y->left : y->right;
+  x_parent = y->parent;
+  if (x != NULL)
+    x->parent = x_parent;
+  replace_child (t, y->parent, y, x);
+  y_red = y->red;
+
+  if (y != e) 
+    {
+      if (x_parent == e)
+        x_parent = y;
+      y->parent = e->parent;
+      y->left = e->left;
+      y->right = e->right;
+      y->red = e->red;
+      if (y->left != NULL)
+        y->left->parent = y;
+      if (y->right != NULL)
+        y->right->parent = y;
+      replace_child (t, e->parent, e, y);
+    }
+
+  if (!y_red)
+    remove_fixup (t, x, x_parent);
+}
+
+/* Returns the smallest element in T, or a null pointer if T is
+   empty. */
+struct rb_elem *
+rb_min (const struct rb_tree *t) 
+{
+  return t->min;
+}
+
+/* Returns the element after E in T's order, or a null pointer
+   if E is the largest element. */
+struct rb_elem *
+rb_next (struct rb_elem *e) 
+{
+  if (e->right != NULL) 
+    {
+      e = e->right;
+      while (e->left != NULL)
+        e = e->left;
+      return e;
+    }
+
+  while (e->parent != NULL && e == e->parent->right)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the number of elements in T. */
+size_t
+rb_size (const struct rb_tree *t) 
+{
+  return t->elem_cnt;
+}
+
+/* Returns true if T is empty, false otherwise. */
+bool
+rb_empty (const struct rb_tree *t) 
+{
+  return t->root == NULL;
+}
+
+/* Rotates the subtree rooted at X to the left, making X's right
+   child its parent. */
+static void
+rotate_left (struct rb_tree *t, struct rb_elem *x) 
+{
+  struct rb_elem *y = x->right;
+
+  x->right = y->left;
+  if (y->left != NULL)
+    y->left->parent = x;
+  y->parent = x->parent;
+  replace_child (t, x->parent, x, y);
+  y->left = x;
+  x->parent = y;
+}
+
+/* Rotates the subtree rooted at X to the right, making X's left
+   child its parent. */
+static void
+rotate_right (struct rb_tree *t, struct rb_elem *x) 
+{
+  struct rb_elem *y = x->left;
+
+  x->left = y->right;
+  if (y->right != NULL)
+    y->right->parent = x;
+  y->parent = x->parent;
+  replace_child (t, x->parent, x, y);
+  y->right = x;
+  x->parent = y;
+}
+
+/* Makes NEW take OLD's place as a child of PARENT, or as the
+   root of T if PARENT is null.  Does not update NEW's parent
+   pointer. */
+static void
+replace_child (struct rb_tree *t, struct rb_elem *parent,
+               struct rb_elem *old, struct rb_elem *new) 
+{
+  if (parent == NULL)
+    t->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+}
+
+/* Restores the red-black properties after a black node was
+   unlinked from above X, which is a child (possibly null) of
+   PARENT. */
+static void
+remove_fixup (struct rb_tree *t, struct rb_elem *x, struct rb_elem *parent) 
+{
+  while (x != t->root && !is_red (x)) 
+    {
+      if (x == parent->left) 
+        {
+          struct rb_elem *w = parent->right;
+          if (is_red (w)) 
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_left (t, parent);
+              w = parent->right;
+            }
+          if (!is_red (w->left) && !is_red (w->right)) 
+            {
+              w->red = true;
+              x = parent;
+              parent = x->parent;
+            }
+          else 
+            {
+              if (!is_red (w->right)) 
+                {
+                  w->left->red = false;
+                  w->red = true;
+                  rotate_right (t, w);
+                  w = parent->right;
+                }
+              w->red = parent->red;
+              parent->red = false;
+              w->right->red = false;
+              rotate_left (t, parent);
+              x = t->root;
+            }
+        }
+      else 
+        {
+          struct rb_elem *w = parent->left;
+          if (is_red (w)) 
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_right (t, parent);
+              w = parent->left;
+            }
+          if (!is_red (w->left) && !is_red (w->right)) 
+            {
+              w->red = true;
+              x = parent;
+              parent = x->parent;
+            }
+          else 
+            {
+              if (!is_red (w->left)) 
+                {
+                  w->right->red = false;
+                  w->red = true;
+                  rotate_left (t, w);
+                  w = parent->left;
+                }
+              w->red = parent->red;
+              parent->red = false;
+              w->left->red = false;
+              rotate_right (t, parent);
+              x = t->root;
+            }
+        }
+    }
+  if (x != NULL)
+    x->red = false;
+}
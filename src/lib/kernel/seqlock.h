@@ -0,0 +1,93 @@
+#ifndef __LIB_KERNEL_SEQLOCK_H
+#define __LIB_KERNEL_SEQLOCK_H
+
+/* Sequence lock.
+
+   Protects read-mostly data, such as a 64-bit counter that
+   cannot be read in a single instruction, without making
+   readers lock anything.  The writer bumps a sequence number
+   before and after each update, so that it is odd while an
+   update is in progress.  A reader notes the sequence number,
+   reads the data, and tries again if the number was odd or has
+   changed in the meantime:
+
+      unsigned seq;
+      int64_t t;
+
+      do
+        {
+          seq = seqlock_read_begin (&lock);
+          t = ticks;
+        }
+      while (seqlock_read_retry (&lock, seq));
+
+   Writers must be serialized with each other and must not be
+   preempted by a reader that could spin on them.  In this
+   uniprocessor kernel, that means updating with interrupts
+   turned off, as interrupt handlers do anyway.  Readers may run
+   anywhere, including interrupt handlers, and never touch the
+   interrupt flag.
+
+   A reader may see torn data before it retries, so it should do
+   nothing with what it reads until seqlock_read_retry() returns
+   false. */
+
+#include <stdbool.h>
+
+/* Sequence lock. */
+struct seqlock
+  {
+    unsigned seq;               /* Odd while a write is in progress. */
+  };
+
+/* Initializer for a sequence lock with static storage duration. */
+#define SEQLOCK_INITIALIZER { 0 }
+
+/* Optimization barrier: keeps the compiler from moving memory
+   accesses across the sequence number reads and writes. */
+#define seqlock_barrier() asm volatile ("" : : : "memory")
+
+/* Initializes LOCK. */
+static inline void
+seqlock_init (struct seqlock *lock)
+{
+  lock->seq = 0;
+}
+
+/* Begins a read of the data protected by LOCK.  Returns the
+   value to pass to seqlock_read_retry() after the read. */
+static inline unsigned
+seqlock_read_begin (const struct seqlock *lock)
+{
+  unsigned seq = *(const volatile unsigned *) &lock->seq;
+  seqlock_barrier ();
+  return seq;
+}
+
+/* Returns true if a read of the data protected by LOCK that
+   began when seqlock_read_begin() returned SEQ overlapped a
+   write, in which case the read must be repeated. */
+static inline bool
+seqlock_read_retry (const struct seqlock *lock, unsigned seq)
+{
+  seqlock_barrier ();
+  return (seq & 1) != 0 || *(const volatile unsigned *) &lock->seq != seq;
+}
+
+/* Begins an update of the data protected by LOCK. */
+static inline void
+seqlock_write_begin (struct seqlock *lock)
+{
+  lock->seq++;
+  seqlock_barrier ();
+}
+
+/* Ends an update of the data protected by LOCK. */
+static inline void
+seqlock_write_end (struct seqlock *lock)
+{
+  seqlock_barrier ();
+  lock->seq++;
+}
+
+#endif /* lib/kernel/seqlock.h */
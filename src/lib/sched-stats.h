@@ -0,0 +1,29 @@
+/*! \file sched-stats.h
+ *
+ * Scheduling statistics kept by the kernel for each thread, shared between
+ * the kernel and user programs (see the sched_stats() system call).  Times
+ * are in CPU cycles, as counted by the time-stamp counter.
+ */
+
+#ifndef __LIB_SCHED_STATS_H
+#define __LIB_SCHED_STATS_H
+
+#include <stdint.h>
+
+/*! Number of buckets in the run queue delay histogram.  Bucket 0 counts
+    delays of 0 cycles and bucket I counts delays of 2**(I-1) up to 2**I - 1
+    cycles.  The last bucket also counts every longer delay. */
+#define SCHED_HIST_BUCKETS 40
+
+/*! Scheduling statistics for one thread. */
+struct sched_stats {
+    uint64_t run_cycles;            /*!< Time spent running. */
+    uint64_t wait_cycles;           /*!< Time spent ready but not running. */
+    uint64_t wakeup_cycles;         /*!< Total wakeup-to-run latency. */
+    uint64_t max_wakeup_cycles;     /*!< Worst wakeup-to-run latency. */
+    unsigned wakeups;               /*!< Times made ready after blocking. */
+    unsigned voluntary_switches;    /*!< Times it blocked or exited. */
+    unsigned involuntary_switches;  /*!< Times it was preempted or yielded. */
+};
+
+#endif /* lib/sched-stats.h */
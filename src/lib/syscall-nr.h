@@ -34,7 +34,10 @@ enum {
     SYS_MKDIR,                  /*!< Create a directory. */
     SYS_READDIR,                /*!< Reads a directory entry. */
     SYS_ISDIR,                  /*!< Tests if a fd represents a directory. */
-    SYS_INUMBER                 /*!< Returns the inode number for a fd. */
+    SYS_INUMBER,                /*!< Returns the inode number for a fd. */
+
+    /* Instrumentation. */
+    SYS_SCHED_STATS             /*!< Reads a thread's scheduling statistics. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -153,3 +153,8 @@ int inumber(int fd) {
     return syscall1(SYS_INUMBER, fd);
 }
 
+bool sched_stats(pid_t pid, struct sched_stats *stats,
+                 unsigned hist[SCHED_HIST_BUCKETS]) {
+    return syscall3(SYS_SCHED_STATS, pid, stats, hist);
+}
+
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <sched-stats.h>
 
 /*! Process identifier. */
 typedef int pid_t;
@@ -45,5 +46,8 @@ bool readdir(int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir(int fd);
 int inumber(int fd);
 
+/* Instrumentation. */
+bool sched_stats(pid_t, struct sched_stats *, unsigned hist[SCHED_HIST_BUCKETS]);
+
 #endif /* lib/user/syscall.h */
 
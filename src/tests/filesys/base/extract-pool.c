@@ -0,0 +1,5 @@
+/* Checks that `extract -pool-extract', reading the scratch
+   device ahead on the worker pool, puts each file into the file
+   system intact, just like extract-serial. */
+
+#include "tests/filesys/base/extract.inc"
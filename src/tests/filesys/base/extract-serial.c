@@ -0,0 +1,6 @@
+/* Checks that `extract', reading the scratch device one sector
+   at a time, puts each file into the file system intact: this
+   program and two others, each more than one read-ahead chunk
+   long and ending partway through a sector. */
+
+#include "tests/filesys/base/extract.inc"
@@ -0,0 +1,34 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::cksum;
+
+# Checks that the files extracted for $test match the files
+# put on the scratch device, and that `extract' reported how
+# long it took, with " (pooled)" after the time if $pooled.
+sub check_extract {
+    my ($pooled) = @_;
+    our ($test);
+    my ($name) = $test;
+    $name =~ s%.*/%%;
+
+    my (@output) = read_text_file ("$test.output");
+    my ($suffix) = $pooled ? " \\(pooled\\)" : "";
+    fail "Extraction time missing from output.\n"
+      if !grep (/^Extracted 3 files in \d+ us$suffix\.$/, @output);
+
+    my ($expected) = "($name) begin\n";
+    foreach my $file ($test, map ("tests/filesys/base/$_",
+				  qw (child-syn-read child-syn-wrt))) {
+	my ($file_name) = $file;
+	$file_name =~ s%.*/%%;
+	$expected .= "($name) open \"$file_name\"\n";
+	$expected .= sprintf ("($name) %s: %d bytes, cksum %s\n",
+			      $file_name, -s $file, cksum_file ($file));
+    }
+    $expected .= "($name) end\n";
+    check_expected (IGNORE_EXIT_CODES => 1, [$expected]);
+}
+
+1;
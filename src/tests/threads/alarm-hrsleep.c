@@ -0,0 +1,62 @@
+/* Checks that sub-tick sleeps block on a high-resolution timer
+   instead of busy-waiting.  Sleeps for several durations shorter
+   than a tick with timer_usleep(), and reports how late the
+   sleeps end, as measured by the TSC clock, and how much of the
+   time the sleeping thread spent on the CPU.  A busy-wait would
+   use nearly all of it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_CNT 20
+
+static const int durations_us[] = {50, 200, 1000, 5000};
+
+void
+test_alarm_hrsleep (void) 
+{
+  struct sched_stats before, after;
+  int64_t start, total;
+  uint64_t start_tsc;
+  int percent;
+  size_t i;
+
+  thread_get_sched_stats (thread_tid (), &before, NULL);
+  start = clock_ns ();
+  start_tsc = rdtsc ();
+  for (i = 0; i < sizeof durations_us / sizeof *durations_us; i++)
+    {
+      int64_t late_sum = 0, late_max = 0;
+      int j;
+
+      for (j = 0; j < SLEEP_CNT; j++)
+        {
+          int64_t then = clock_ns ();
+          int64_t late;
+
+          timer_usleep (durations_us[i]);
+          late = clock_ns () - then - durations_us[i] * 1000LL;
+          if (late < 0)
+            fail ("%d us sleep ended %lld ns early",
+                  durations_us[i], -late);
+          late_sum += late;
+          if (late > late_max)
+            late_max = late;
+        }
+      msg ("%d us sleeps: %lld us late on average, %lld us max.",
+           durations_us[i], late_sum / SLEEP_CNT / 1000, late_max / 1000);
+    }
+  thread_get_sched_stats (thread_tid (), &after, NULL);
+  percent = ((after.run_cycles - before.run_cycles) * 100
+             / (rdtsc () - start_tsc));
+  total = clock_ns () - start;
+  msg ("Sleeping thread was on the CPU %d%% of %lld ms.",
+       percent, total / 1000000);
+  if (percent >= 50)
+    fail ("sub-tick sleeps are not blocking");
+  pass ();
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $us (50, 200, 1000, 5000) {
+    fail "Measurement of $us us sleeps missing from output.\n"
+      if !grep (/^\(alarm-hrsleep\) $us us sleeps: \d+ us late on average, \d+ us max\.$/,
+		@output);
+}
+fail "CPU use missing from output.\n"
+  if !grep (/^\(alarm-hrsleep\) Sleeping thread was on the CPU \d+% of \d+ ms\.$/,
+	    @output);
+fail "Test did not pass.\n"
+  if !grep (/^\(alarm-hrsleep\) PASS$/, @output);
+pass;
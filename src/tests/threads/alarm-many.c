@@ -0,0 +1,112 @@
+/* Creates 1,000 threads that each sleep several times for
+   different lengths of time, so that the sleep queue always holds
+   hundreds of threads whose wake-up times are spread over several
+   hundred ticks.  Verifies that no thread wakes up early, and
+   reports the latest wake-up and how much time was spent in the
+   timer interrupt handler while they slept. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEPER_CNT 1000
+#define ITER_CNT 3
+#define STRIDE 300              /* Ticks between a sleeper's wake-ups. */
+
+/* Information about the test. */
+struct sleep_test 
+  {
+    int64_t start;              /* Time the first sleep is based on. */
+    struct semaphore done;      /* Upped by each sleeper on exit. */
+    int early_cnt;              /* Number of early wake-ups. */
+    int64_t max_late;           /* Most ticks any wake-up was late. */
+  };
+
+/* Information about an individual sleeper. */
+struct sleeper 
+  {
+    struct sleep_test *test;    /* The test being run. */
+    int id;                     /* Sleeper ID. */
+  };
+
+static struct sleeper sleepers[SLEEPER_CNT];
+
+static thread_func sleeper;
+
+void
+test_alarm_many (void) 
+{
+  struct sleep_test test;
+  struct timer_isr_stats stats;
+  int64_t start;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Creating %d threads to sleep %d times each.", SLEEPER_CNT, ITER_CNT);
+
+  test.start = timer_ticks () + 2 * TIMER_FREQ;
+  sema_init (&test.done, 0);
+  test.early_cnt = 0;
+  test.max_late = 0;
+
+  for (i = 0; i < SLEEPER_CNT; i++) 
+    {
+      struct sleeper *s = &sleepers[i];
+      char name[16];
+
+      s->test = &test;
+      s->id = i;
+      snprintf (name, sizeof name, "sleeper %d", i);
+      if (thread_create (name, PRI_DEFAULT, sleeper, s) == TID_ERROR)
+        fail ("couldn't create thread %d", i);
+    }
+
+  timer_reset_isr_stats ();
+  start = timer_ticks ();
+  for (i = 0; i < SLEEPER_CNT; i++)
+    sema_down (&test.done);
+  timer_get_isr_stats (&stats);
+  start = timer_elapsed (start);
+
+  if (test.early_cnt != 0)
+    fail ("%d wake-ups happened before the requested tick", test.early_cnt);
+  msg ("No thread woke up early.");
+  msg ("Latest wake-up was %lld ticks late.", test.max_late);
+
+  msg ("%lld timer interrupts in %lld ticks.", stats.count, start);
+  msg ("%lld timer interrupts, %llu cycles each on average, %llu max.",
+       stats.count, stats.cycles / (stats.count ? stats.count : 1),
+       stats.max_cycles);
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *s_) 
+{
+  struct sleeper *s = s_;
+  struct sleep_test *test = s->test;
+  int i;
+
+  for (i = 1; i <= ITER_CNT; i++) 
+    {
+      int64_t sleep_until = test->start + i * STRIDE + s->id * 37 % STRIDE;
+      enum intr_level old_level;
+      int64_t late;
+
+      timer_sleep (sleep_until - timer_ticks ());
+      old_level = intr_disable ();
+      late = timer_ticks () - sleep_until;
+      if (late < 0)
+        test->early_cnt++;
+      else if (late > test->max_late)
+        test->max_late = late;
+      intr_set_level (old_level);
+    }
+  sema_up (&test->done);
+}
@@ -0,0 +1,37 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Sleepers were not created.\n"
+  if !grep (/Creating 1000 threads to sleep 3 times each\./, @output);
+fail "Wake-up check did not complete.\n"
+  if !grep (/No thread woke up early\./, @output);
+
+my ($late, $interrupts, $ticks, $avg, $max);
+foreach (@output) {
+    ($late) = /Latest wake-up was (\d+) ticks late\./ if !defined $late;
+    ($interrupts, $ticks) = /(\d+) timer interrupts in (\d+) ticks\./
+      if !defined $ticks;
+    ($avg, $max) = /\d+ timer interrupts, (\d+) cycles each on average, (\d+) max\./
+      if !defined $max;
+}
+fail "Wake-up lateness missing from output.\n" if !defined $late;
+fail "A thread woke up $late ticks late, expected at most 5.\n" if $late > 5;
+fail "Timer interrupt statistics missing from output.\n"
+  if !defined $ticks || !defined $max;
+
+# The sleepers' wake-ups span three strides of 300 ticks, and the
+# periodic tick interrupts at least once per tick.
+fail "Sleeps took only $ticks ticks, expected at least 900.\n" if $ticks < 900;
+fail "Only $interrupts timer interrupts in $ticks ticks.\n"
+  if $interrupts < $ticks;
+fail "Average interrupt of $avg cycles is longer than the longest, $max.\n"
+  if $avg > $max || $max == 0;
+pass;
@@ -0,0 +1,38 @@
+/* Sleeps for a long time with nothing else to run and counts the
+   timer interrupts taken meanwhile.  With the -nohz kernel option
+   the idle thread stops the periodic tick, so there should be far
+   fewer interrupts than ticks; without it, there is one per tick. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_TICKS (5 * TIMER_FREQ)
+
+void
+test_alarm_nohz (void) 
+{
+  struct timer_isr_stats stats;
+  int64_t start, elapsed;
+
+  msg ("Sleeping for %d ticks.", SLEEP_TICKS);
+
+  /* Start on a tick boundary. */
+  timer_sleep (1);
+
+  timer_reset_isr_stats ();
+  start = timer_ticks ();
+  timer_sleep (SLEEP_TICKS);
+  elapsed = timer_elapsed (start);
+  timer_get_isr_stats (&stats);
+
+  if (elapsed < SLEEP_TICKS)
+    fail ("woke up after only %lld ticks", elapsed);
+  msg ("%lld timer interrupts in %lld ticks.", stats.count, elapsed);
+
+  if (timer_nohz && stats.count * 2 > elapsed)
+    fail ("tickless idle did not reduce timer interrupts");
+  msg ("Done.");
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($interrupts, $ticks);
+foreach (@output) {
+    ($interrupts, $ticks) = /(\d+) timer interrupts in (\d+) ticks\./
+      and last;
+}
+fail "Interrupt count missing from output.\n" if !defined $interrupts;
+fail "Slept for $ticks ticks but took $interrupts timer interrupts.\n"
+  if $interrupts * 2 > $ticks;
+fail "Test did not complete.\n" if !grep (/Done\./, @output);
+pass;
@@ -0,0 +1,193 @@
+/* Measures bitmap searching on a map of 1M bits.  Each search is
+   run both with the bitmap functions and with a reference that
+   tests one bit at a time, as bitmap_scan() used to, on an
+   identical map, and the two must agree.  Reports the average
+   time per call of each:
+
+     - "first fit": finding and marking single free bits, always
+       searching from bit 0, in a map that is 99% used;
+
+     - "next fit": the same, with bitmap_scan_and_flip_next();
+
+     - "run of 64": searching a half-used map for 64 free bits in
+       a row, of which there are none;
+
+     - "count": counting the used bits in the whole map. */
+
+#include <bitmap.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "devices/timer.h"
+
+#define BIT_CNT (1024 * 1024)
+#define FIT_CNT 256
+#define RUN_LEN 64
+#define RUN_CNT 4
+#define COUNT_CNT 16
+
+static struct bitmap *word_map, *bit_map;
+
+static void fill (unsigned used_pct);
+static void report (const char *what, uint64_t bit_cycles,
+                    uint64_t word_cycles, unsigned calls);
+static size_t ref_scan (const struct bitmap *, size_t start, size_t cnt);
+static size_t ref_count (const struct bitmap *);
+
+void
+test_bitmap_scan (void)
+{
+  uint64_t bit_cycles, word_cycles, start;
+  size_t hint, idx, ref_idx;
+  size_t cnt = 0, ref_cnt = 0;
+  int i;
+
+  word_map = bitmap_create (BIT_CNT);
+  bit_map = bitmap_create (BIT_CNT);
+  if (word_map == NULL || bit_map == NULL)
+    fail ("out of memory creating bitmaps");
+  random_init (0);
+
+  /* First fit. */
+  fill (99);
+  bit_cycles = word_cycles = 0;
+  for (i = 0; i < FIT_CNT; i++)
+    {
+      start = rdtsc ();
+      ref_idx = ref_scan (bit_map, 0, 1);
+      if (ref_idx != BITMAP_ERROR)
+        bitmap_mark (bit_map, ref_idx);
+      bit_cycles += rdtsc () - start;
+
+      start = rdtsc ();
+      idx = bitmap_scan_and_flip (word_map, 0, 1, false);
+      word_cycles += rdtsc () - start;
+
+      if (idx != ref_idx)
+        fail ("first fit found bit %zu, expected %zu", idx, ref_idx);
+    }
+  report ("First fit", bit_cycles, word_cycles, FIT_CNT);
+
+  /* Next fit. */
+  fill (99);
+  bit_cycles = word_cycles = 0;
+  hint = 0;
+  for (i = 0; i < FIT_CNT; i++)
+    {
+      start = rdtsc ();
+      ref_idx = ref_scan (bit_map, hint, 1);
+      if (ref_idx == BITMAP_ERROR)
+        ref_idx = ref_scan (bit_map, 0, 1);
+      if (ref_idx != BITMAP_ERROR)
+        {
+          bitmap_mark (bit_map, ref_idx);
+          hint = ref_idx + 1;
+        }
+      bit_cycles += rdtsc () - start;
+
+      start = rdtsc ();
+      idx = bitmap_scan_and_flip_next (word_map, 1, false);
+      word_cycles += rdtsc () - start;
+
+      if (idx != ref_idx)
+        fail ("next fit found bit %zu, expected %zu", idx, ref_idx);
+    }
+  report ("Next fit", bit_cycles, word_cycles, FIT_CNT);
+
+  /* Run of 64. */
+  fill (50);
+  bit_cycles = word_cycles = 0;
+  for (i = 0; i < RUN_CNT; i++)
+    {
+      start = rdtsc ();
+      ref_idx = ref_scan (bit_map, 0, RUN_LEN);
+      bit_cycles += rdtsc () - start;
+
+      start = rdtsc ();
+      idx = bitmap_scan (word_map, 0, RUN_LEN, false);
+      word_cycles += rdtsc () - start;
+
+      if (idx != ref_idx)
+        fail ("run search found bit %zu, expected %zu", idx, ref_idx);
+    }
+  report ("Run of 64", bit_cycles, word_cycles, RUN_CNT);
+
+  /* Count. */
+  bit_cycles = word_cycles = 0;
+  for (i = 0; i < COUNT_CNT; i++)
+    {
+      start = rdtsc ();
+      ref_cnt = ref_count (bit_map);
+      bit_cycles += rdtsc () - start;
+
+      start = rdtsc ();
+      cnt = bitmap_count (word_map, 0, BIT_CNT, true);
+      word_cycles += rdtsc () - start;
+    }
+  if (cnt != ref_cnt)
+    fail ("counted %zu bits, expected %zu", cnt, ref_cnt);
+  report ("Count", bit_cycles, word_cycles, COUNT_CNT);
+
+  bitmap_destroy (word_map);
+  bitmap_destroy (bit_map);
+  pass ();
+}
+
+/* Sets a random USED_PCT percent of the bits in both maps, and
+   resets the rest. */
+static void
+fill (unsigned used_pct)
+{
+  size_t i;
+
+  bitmap_set_all (word_map, false);
+  for (i = 0; i < BIT_CNT; i++)
+    if (random_ulong () % 100 < used_pct)
+      bitmap_mark (word_map, i);
+  for (i = 0; i < BIT_CNT; i++)
+    bitmap_set (bit_map, i, bitmap_test (word_map, i));
+}
+
+/* Prints the average time per call of the reference and of the
+   bitmap functions. */
+static void
+report (const char *what, uint64_t bit_cycles, uint64_t word_cycles,
+        unsigned calls)
+{
+  msg ("%s: %lld ns per call bit at a time, %lld ns word at a time.",
+       what, clock_cycles_to_ns (bit_cycles / calls),
+       clock_cycles_to_ns (word_cycles / calls));
+}
+
+/* Returns the index of the first run of CNT free bits in B at or
+   after START, or BITMAP_ERROR, testing one bit at a time. */
+static size_t
+ref_scan (const struct bitmap *b, size_t start, size_t cnt)
+{
+  size_t i, j;
+
+  for (i = start; i + cnt <= bitmap_size (b); i++)
+    {
+      for (j = 0; j < cnt; j++)
+        if (bitmap_test (b, i + j))
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Returns the number of used bits in B, testing one bit at a
+   time. */
+static size_t
+ref_count (const struct bitmap *b)
+{
+  size_t i, cnt = 0;
+
+  for (i = 0; i < bitmap_size (b); i++)
+    if (bitmap_test (b, i))
+      cnt++;
+  return cnt;
+}
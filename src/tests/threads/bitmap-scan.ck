@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $what ("First fit", "Next fit", "Run of 64", "Count") {
+    fail "$what timing missing from output.\n"
+      if !grep (/^\(bitmap-scan\) $what: \d+ ns per call bit at a time, \d+ ns word at a time\.$/,
+		@output);
+}
+fail "Test did not pass.\n"
+  if !grep (/^\(bitmap-scan\) PASS$/, @output);
+pass;
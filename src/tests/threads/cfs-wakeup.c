@@ -0,0 +1,84 @@
+/* Measures how promptly the completely fair scheduler runs a
+   thread that wakes up while the CPU is busy.  SPINNER_CNT
+   threads spin for the whole test while another thread
+   repeatedly sleeps for a few ticks and records how many ticks
+   late it resumed.  Because the sleeper uses almost no CPU time,
+   its vruntime stays behind the spinners' and it should preempt
+   them as soon as it wakes, so it should never be more than one
+   tick late.  Under round-robin scheduling it would instead wait
+   behind every spinner's time slice. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SPINNER_CNT 4
+#define WAKEUP_CNT 100
+#define SLEEP_TICKS 3
+
+static volatile bool stop;
+static struct semaphore done;
+
+static thread_func spinner;
+static thread_func sleeper;
+
+void
+test_cfs_wakeup (void) 
+{
+  int i;
+
+  ASSERT (thread_cfs);
+
+  sema_init (&done, 0);
+  stop = false;
+
+  for (i = 0; i < SPINNER_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "spin %d", i);
+      thread_create (name, PRI_DEFAULT, spinner, NULL);
+    }
+  thread_create ("sleeper", PRI_DEFAULT, sleeper, NULL);
+
+  sema_down (&done);
+  stop = true;
+  for (i = 0; i < SPINNER_CNT; i++)
+    sema_down (&done);
+}
+
+/* Wakes up WAKEUP_CNT times while the spinners run and reports
+   the worst and total lateness. */
+static void
+sleeper (void *aux UNUSED) 
+{
+  int64_t max_late = 0;
+  int64_t total_late = 0;
+  int i;
+
+  for (i = 0; i < WAKEUP_CNT; i++) 
+    {
+      int64_t due = timer_ticks () + SLEEP_TICKS;
+      int64_t late;
+
+      timer_sleep (SLEEP_TICKS);
+      late = timer_ticks () - due;
+      if (late > max_late)
+        max_late = late;
+      total_late += late;
+    }
+
+  msg ("%d wakeups with %d spinners: %lld ticks late at most, "
+       "%lld in total.", WAKEUP_CNT, SPINNER_CNT, max_late, total_late);
+  sema_up (&done);
+}
+
+static void
+spinner (void *aux UNUSED) 
+{
+  while (!stop)
+    continue;
+  sema_up (&done);
+}
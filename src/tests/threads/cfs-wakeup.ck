@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($max);
+foreach (@output) {
+    ($max) = /wakeups with \d+ spinners: (\d+) ticks late at most/ and last;
+}
+fail "Wakeup latency missing from output.\n" if !defined $max;
+fail "Sleeper woke up $max ticks late, expected at most 1.\n" if $max > 1;
+pass;
@@ -0,0 +1,59 @@
+/* Checks the TSC-based clock_ns() against the timer tick it was
+   calibrated with.  Reads the clock many times to check that it
+   never goes backward and to find its resolution, then times
+   a sleep of a number of ticks and a busy-wait with it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READ_CNT 100000
+#define SLEEP_TICKS 10
+
+void
+test_clock_ns (void) 
+{
+  int64_t prev, now, step, resolution = 0;
+  int64_t tick_ns = 1000000000 / TIMER_FREQ;
+  int64_t start, elapsed;
+  int i;
+
+  /* Monotonicity and resolution. */
+  prev = clock_ns ();
+  for (i = 0; i < READ_CNT; i++)
+    {
+      now = clock_ns ();
+      step = now - prev;
+      if (step < 0)
+        fail ("clock went backward by %lld ns", -step);
+      if (step > 0 && (resolution == 0 || step < resolution))
+        resolution = step;
+      prev = now;
+    }
+  if (resolution == 0)
+    fail ("clock did not advance over %d reads", READ_CNT);
+  msg ("Clock resolution: %lld ns or better.", resolution);
+
+  /* A sleep of SLEEP_TICKS ticks, which starts on a tick boundary,
+     should take SLEEP_TICKS ticks give or take one. */
+  timer_sleep (1);
+  start = clock_ns ();
+  timer_sleep (SLEEP_TICKS);
+  elapsed = clock_elapsed_ns (start);
+  if (elapsed < (SLEEP_TICKS - 1) * tick_ns
+      || elapsed > (SLEEP_TICKS + 1) * tick_ns)
+    fail ("%d tick sleep took %lld ns", SLEEP_TICKS, elapsed);
+  msg ("%d tick sleep took %d ticks.", SLEEP_TICKS,
+       (int) ((elapsed + tick_ns / 2) / tick_ns));
+
+  /* A busy-wait must not end early. */
+  start = clock_ns ();
+  timer_udelay (1000);
+  elapsed = clock_elapsed_ns (start);
+  if (elapsed < 1000000)
+    fail ("1000 us delay took %lld ns", elapsed);
+  msg ("1000 us delay did not end early.");
+  pass ();
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Clock resolution missing from output.\n"
+  if !grep (/^\(clock-ns\) Clock resolution: \d+ ns or better\.$/, @output);
+fail "Clock disagrees with the timer tick.\n"
+  if !grep (/^\(clock-ns\) 10 tick sleep took (9|10|11) ticks\.$/, @output);
+fail "Test did not pass.\n"
+  if !grep (/^\(clock-ns\) PASS$/, @output);
+pass;
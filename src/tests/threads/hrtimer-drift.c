@@ -0,0 +1,70 @@
+/* Checks that arming high-resolution timers does not lose timer
+   ticks.  Each round turns interrupts off, waits for the periodic
+   tick to fire so that its interrupt is pending, starts an
+   hrtimer a millisecond out, and turns interrupts back on, then
+   waits for the hrtimer to fire.  The pending tick must still
+   count as a tick, not as the end of the hrtimer's one-shot.  At
+   the end, the ticks that timer_ticks() counted must match the
+   time that passed by the TSC clock, and no hrtimer may have
+   fired early. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "devices/timer.h"
+
+#define ROUND_CNT 100
+#define DELAY_NS 1000000
+
+static struct semaphore fired;
+static int early_cnt;
+
+static hrtimer_func expire;
+
+void
+test_hrtimer_drift (void)
+{
+  struct hrtimer timer;
+  int64_t start_ns, start_ticks, elapsed_ns, ticks, expected;
+  int i;
+
+  sema_init (&fired, 0);
+  hrtimer_init (&timer, expire, NULL);
+
+  timer_sleep (1);
+  start_ticks = timer_ticks ();
+  start_ns = clock_ns ();
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      enum intr_level old_level = intr_disable ();
+      while (!intr_pending (0x20))
+        continue;
+      hrtimer_start (&timer, DELAY_NS);
+      intr_set_level (old_level);
+      sema_down (&fired);
+    }
+  ticks = timer_elapsed (start_ticks);
+  elapsed_ns = clock_ns () - start_ns;
+  expected = elapsed_ns / (1000000000 / TIMER_FREQ);
+
+  msg ("%d hrtimers fired, %d early.", ROUND_CNT, early_cnt);
+  msg ("%lld ticks counted in %lld ms, %lld expected.",
+       ticks, elapsed_ns / 1000000, expected);
+  if (early_cnt != 0)
+    fail ("%d hrtimers fired early", early_cnt);
+  if (ticks < expected - 2 || ticks > expected + 2)
+    fail ("timer_ticks() drifted by %lld ticks", ticks - expected);
+  pass ();
+}
+
+/* Counts TIMER's expiry, early or not, and wakes the test. */
+static void
+expire (struct hrtimer *timer, void *aux UNUSED)
+{
+  if (rdtsc () < timer->expires)
+    early_cnt++;
+  sema_up (&fired);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($ticks, $expected);
+foreach (@output) {
+    ($ticks, $expected) = /^\(hrtimer-drift\) (\d+) ticks counted in \d+ ms, (\d+) expected\.$/
+      and last;
+}
+fail "Tick count missing from output.\n" if !defined $ticks;
+fail "Counted $ticks ticks, expected $expected.\n"
+  if abs ($ticks - $expected) > 2;
+fail "Test did not pass.\n"
+  if !grep (/^\(hrtimer-drift\) PASS$/, @output);
+pass;
@@ -0,0 +1,102 @@
+/* Exercises the object cache allocator with 536-byte objects,
+   the size of a `struct inode', which malloc() rounds up to
+   1 kB.  Checks that every object is constructed, that live
+   objects do not overlap, that freed objects come back in their
+   constructed state, and that empty slabs are given back by
+   kmem_cache_shrink().  Reports the pages used against what
+   malloc() would need. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+#define OBJ_CNT 70
+#define OBJ_MAGIC 0x0b1ec7
+
+struct object 
+  {
+    unsigned magic;
+    unsigned char fill[532];
+  };
+
+static kmem_ctor construct;
+static int ctor_calls;
+
+void
+test_kmem_cache (void) 
+{
+  static struct object *objs[OBJ_CNT];
+  struct kmem_cache *cache;
+  int i, j, page_cnt;
+
+  cache = kmem_cache_create ("test", sizeof (struct object), construct);
+  if (cache == NULL)
+    fail ("kmem_cache_create failed");
+
+  /* Allocate, check, and fill. */
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL)
+        fail ("allocation %d failed", i);
+      if (objs[i]->magic != OBJ_MAGIC)
+        fail ("object %d was not constructed", i);
+      memset (objs[i]->fill, i, sizeof objs[i]->fill);
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    for (j = 0; j < (int) sizeof objs[i]->fill; j++)
+      if (objs[i]->fill[j] != (unsigned char) i || objs[i]->magic != OBJ_MAGIC)
+        fail ("object %d was overwritten", i);
+
+  /* Count the distinct pages the objects are in. */
+  page_cnt = 0;
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      for (j = 0; j < i; j++)
+        if (pg_round_down (objs[j]) == pg_round_down (objs[i]))
+          break;
+      if (j == i)
+        page_cnt++;
+    }
+  msg ("%d %zu-byte objects: %d pages, malloc would use %zu.",
+       OBJ_CNT, sizeof (struct object), page_cnt,
+       malloc_pages_needed (sizeof (struct object), OBJ_CNT));
+
+  /* Free every other object and allocate again: the freed objects
+     must be reused, still constructed, without new slabs. */
+  for (i = 0; i < OBJ_CNT; i += 2)
+    kmem_cache_free (cache, objs[i]);
+  j = ctor_calls;
+  for (i = 0; i < OBJ_CNT; i += 2) 
+    {
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL || objs[i]->magic != OBJ_MAGIC)
+        fail ("reallocated object %d is not constructed", i);
+    }
+  if (ctor_calls != j)
+    fail ("reallocation created new slabs");
+  msg ("Freed objects were reused.");
+
+  /* Free everything and give the pages back. */
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (cache, objs[i]);
+  if (kmem_cache_shrink (cache) == 0)
+    fail ("shrinking freed no pages");
+  msg ("Shrinking returned the empty slabs.");
+  kmem_cache_destroy (cache);
+  pass ();
+}
+
+/* Constructor. */
+static void
+construct (void *obj_) 
+{
+  struct object *obj = obj_;
+
+  obj->magic = OBJ_MAGIC;
+  ctor_calls++;
+}
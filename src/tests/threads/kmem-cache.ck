@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(kmem-cache) begin
+(kmem-cache) 70 536-byte objects: 10 pages, malloc would use 24.
+(kmem-cache) Freed objects were reused.
+(kmem-cache) Shrinking returned the empty slabs.
+(kmem-cache) PASS
+(kmem-cache) end
+EOF
+pass;
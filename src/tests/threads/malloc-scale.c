@@ -0,0 +1,111 @@
+/* Measures malloc() and free() throughput with several kernel
+   threads allocating at once, with and without the per-thread
+   magazines in front of the size class locks.  Each thread
+   repeatedly allocates a batch of blocks of mixed sizes, fills
+   each with a pattern, checks the patterns, and frees the batch.
+   Timer interrupts preempt threads in the middle of malloc() and
+   free(), so without magazines they contend for the locks.
+   Every thread must get some allocations done in each window, and
+   the checker fails if magazines make allocation much slower. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define WINDOW_TICKS 50
+#define BATCH 8
+
+static const size_t sizes[BATCH] = {16, 24, 64, 100, 200, 512, 40, 1000};
+
+static volatile bool stop;
+static long long allocs;
+static struct semaphore done;
+
+static thread_func allocator;
+static long long measure (int thread_cnt, bool magazines);
+
+void
+test_malloc_scale (void) 
+{
+  int thread_cnt;
+
+  sema_init (&done, 0);
+  for (thread_cnt = 1; thread_cnt <= 8; thread_cnt *= 2) 
+    {
+      long long with = measure (thread_cnt, true);
+      long long without = measure (thread_cnt, false);
+
+      msg ("%d threads: %lld allocs/s with magazines, %lld without.",
+           thread_cnt, with, without);
+    }
+  malloc_magazines = true;
+}
+
+/* Runs THREAD_CNT allocator threads for WINDOW_TICKS ticks, with
+   magazines on or off according to MAGAZINES, and returns the
+   number of allocations per second. */
+static long long
+measure (int thread_cnt, bool magazines) 
+{
+  int i;
+
+  malloc_magazines = magazines;
+  stop = false;
+  allocs = 0;
+
+  for (i = 0; i < thread_cnt; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "alloc%d", i);
+      thread_create (name, PRI_DEFAULT, allocator, NULL);
+    }
+
+  timer_sleep (WINDOW_TICKS);
+  stop = true;
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&done);
+
+  return allocs * TIMER_FREQ / WINDOW_TICKS;
+}
+
+static void
+allocator (void *aux UNUSED) 
+{
+  unsigned char *blocks[BATCH];
+  unsigned char fill = thread_tid ();
+  long long cnt = 0;
+  enum intr_level old_level;
+  size_t i, j;
+
+  while (!stop) 
+    {
+      for (i = 0; i < BATCH; i++) 
+        {
+          blocks[i] = malloc (sizes[i]);
+          if (blocks[i] == NULL)
+            fail ("out of memory");
+          for (j = 0; j < sizes[i]; j += 8)
+            blocks[i][j] = fill + i;
+        }
+      for (i = 0; i < BATCH; i++) 
+        {
+          for (j = 0; j < sizes[i]; j += 8)
+            if (blocks[i][j] != (unsigned char) (fill + i))
+              fail ("block of %zu bytes was overwritten", sizes[i]);
+          free (blocks[i]);
+        }
+      cnt += BATCH;
+    }
+  if (cnt == 0)
+    fail ("%s made no allocations", thread_name ());
+
+  old_level = intr_disable ();
+  allocs += cnt;
+  intr_set_level (old_level);
+  sema_up (&done);
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $n (1, 2, 4, 8) {
+    my ($with, $without);
+    foreach (@output) {
+	($with, $without) = /^\(malloc-scale\) $n threads: (\d+) allocs\/s with magazines, (\d+) without\.$/
+	  and last;
+    }
+    fail "Measurement with $n threads missing from output.\n"
+      if !defined $with;
+    fail "No allocations with $n threads.\n" if $with == 0 || $without == 0;
+
+    # Magazines take the lock only once per half magazine, so they
+    # should never be much slower than locking on every call.
+    fail "With $n threads, magazines managed $with allocs/s, "
+      . "under 80% of the $without without.\n"
+      if $with * 10 < $without * 8;
+}
+pass;
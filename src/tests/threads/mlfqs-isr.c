@@ -0,0 +1,86 @@
+/* Measures how long the timer interrupt handler and the
+   scheduler take under the MLFQS with 10 and then with 60
+   runnable threads, the thread count used by mlfqs-load-60.
+   Each thread spins until the end of a 10-second measurement
+   window while the main thread sleeps.  The per-tick cost and
+   the cost of each scheduling decision are reported for both
+   thread counts; with incremental MLFQS bookkeeping neither
+   should grow with the number of threads, and the checker fails
+   if either triples.  The cost of the work the handler defers
+   to run with interrupts on is reported separately, along with
+   how often it ran. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define WINDOW_SECS 10
+
+static int64_t spin_until;
+static struct semaphore done;
+
+static thread_func spinner;
+static void measure (int thread_cnt);
+
+void
+test_mlfqs_isr (void) 
+{
+  ASSERT (thread_mlfqs);
+
+  sema_init (&done, 0);
+  measure (10);
+  measure (60);
+}
+
+/* Runs THREAD_CNT spinning threads and reports the timer
+   interrupt handler's and the scheduler's cost while they
+   run. */
+static void
+measure (int thread_cnt) 
+{
+  struct timer_isr_stats stats;
+  struct thread_pick_stats pick;
+  int i;
+
+  msg ("Measuring with %d threads...", thread_cnt);
+  spin_until = timer_ticks () + (WINDOW_SECS + 1) * TIMER_FREQ;
+  for (i = 0; i < thread_cnt; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "spin %d", i);
+      thread_create (name, PRI_DEFAULT, spinner, NULL);
+    }
+
+  timer_sleep (TIMER_FREQ / 2);
+  timer_reset_isr_stats ();
+  thread_reset_pick_stats ();
+  timer_sleep (WINDOW_SECS * TIMER_FREQ);
+  timer_get_isr_stats (&stats);
+  thread_get_pick_stats (&pick);
+
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&done);
+
+  msg ("%d threads: %lld timer interrupts, %lld runs of deferred work.",
+       thread_cnt, stats.count, stats.work_count);
+  msg ("%d threads: %llu cycles per tick on average, %llu max.",
+       thread_cnt, stats.cycles / (stats.count ? stats.count : 1),
+       stats.max_cycles);
+  msg ("%d threads: %llu cycles deferred per tick on average, %llu max.",
+       thread_cnt, stats.work_cycles / (stats.count ? stats.count : 1),
+       stats.max_work_cycles);
+  msg ("%d threads: %lld scheduling decisions, %llu cycles on average, "
+       "%llu max.", thread_cnt, pick.count,
+       pick.cycles / (pick.count ? pick.count : 1), pick.max_cycles);
+}
+
+static void
+spinner (void *aux UNUSED) 
+{
+  while (timer_ticks () < spin_until)
+    continue;
+  sema_up (&done);
+}
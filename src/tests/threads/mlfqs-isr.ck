@@ -0,0 +1,61 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my (%avg, %pick);
+foreach my $cnt (10, 60) {
+    my ($interrupts, $runs);
+    foreach (@output) {
+	($interrupts, $runs)
+	  = /^\(mlfqs-isr\) $cnt threads: (\d+) timer interrupts, (\d+) runs of deferred work\.$/
+	  and last;
+    }
+    fail "Interrupt count with $cnt threads missing from output.\n"
+      if !defined $interrupts;
+
+    # The window is 1,000 ticks.  The deferred work runs once for each
+    # tick, or once for several if ticks arrive while it is running.
+    fail "Only $interrupts timer interrupts in the $cnt-thread window.\n"
+      if $interrupts < 1000;
+    fail "Deferred work ran $runs times for $interrupts interrupts.\n"
+      if $runs > $interrupts || $runs < $interrupts / 2;
+
+    foreach (@output) {
+	($avg{$cnt}) = /^\(mlfqs-isr\) $cnt threads: (\d+) cycles per tick on average, \d+ max\.$/
+	  and last;
+    }
+    fail "Measurement with $cnt threads missing from output.\n"
+      if !defined $avg{$cnt};
+    fail "Deferred work measurement with $cnt threads missing from output.\n"
+      if !grep (/^\(mlfqs-isr\) $cnt threads: \d+ cycles deferred per tick on average, \d+ max\.$/,
+		@output);
+
+    my ($decisions);
+    foreach (@output) {
+	($decisions, $pick{$cnt})
+	  = /^\(mlfqs-isr\) $cnt threads: (\d+) scheduling decisions, (\d+) cycles on average, \d+ max\.$/
+	  and last;
+    }
+    fail "Scheduler measurement with $cnt threads missing from output.\n"
+      if !defined $decisions;
+
+    # Spinners are preempted at least once per time slice.
+    fail "Only $decisions scheduling decisions in the $cnt-thread window.\n"
+      if $decisions < 1000 / 4;
+}
+
+# Six times the threads must not make each tick much more expensive.
+fail "Timer interrupt took $avg{60} cycles with 60 threads, "
+  . "over 3 times the $avg{10} with 10.\n"
+  if $avg{60} > 3 * $avg{10};
+fail "Scheduling decision took $pick{60} cycles with 60 threads, "
+  . "over 3 times the $pick{10} with 10.\n"
+  if $pick{60} > 3 * $pick{10};
+pass;
@@ -0,0 +1,36 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($calls) = 0;
+foreach my $what ("Allocate", "Free") {
+    my ($cnt);
+    foreach (@output) {
+	($cnt) = /^\(palloc-frag-buddy\) $what: \d+ ns average, \d+ ns worst, over (\d+) calls\.$/
+	  and last;
+    }
+    fail "$what latency missing from output.\n" if !defined $cnt;
+    $calls += $cnt;
+}
+fail "$calls allocations and frees, expected 4000.\n" if $calls != 4000;
+
+my ($largest, $free);
+foreach (@output) {
+    ($largest, $free) = /^\(palloc-frag-buddy\) Largest free run: (\d+) of (\d+) free pages \(\d+%\); \d+ allocations failed\.$/
+      and last;
+}
+fail "Fragmentation missing from output.\n" if !defined $largest;
+fail "Largest free run of $largest pages, but $free pages free.\n"
+  if $largest > $free || $free == 0;
+fail "Pages were not all given back.\n"
+  if !grep (/^\(palloc-frag-buddy\) All \d+ free pages were given back\.$/, @output);
+fail "Test did not pass.\n"
+  if !grep (/^\(palloc-frag-buddy\) PASS$/, @output);
+pass;
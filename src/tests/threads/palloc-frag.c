@@ -0,0 +1,184 @@
+/* Measures page allocator latency and fragmentation.  Allocates
+   and frees random runs of 1 to MAX_RUN pages from the user pool,
+   keeping up to SLOT_CNT runs live, and reports the average and
+   worst time per allocation and per free.  Then reports the
+   largest run that can still be allocated against the number of
+   free pages, and checks that freeing every run gives back all of
+   the pages that were free at the start.
+
+   palloc-frag runs with the default bitmap scan, palloc-frag-buddy
+   with the buddy allocator for the user pool. */
+
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define SLOT_CNT 48
+#define MAX_RUN 16
+#define ROUND_CNT 4000
+
+struct run 
+  {
+    uint8_t *pages;
+    size_t page_cnt;
+  };
+
+struct latency 
+  {
+    uint64_t total;
+    uint64_t max;
+    unsigned cnt;
+  };
+
+static void record (struct latency *, uint64_t start);
+static void report (const char *what, const struct latency *);
+static void check_run (const struct run *);
+static size_t count_free (void);
+static size_t largest_free (size_t limit);
+
+void
+test_palloc_frag (void) 
+{
+  static struct run runs[SLOT_CNT];
+  struct latency alloc_lat = {0, 0, 0}, free_lat = {0, 0, 0};
+  size_t start_free_cnt, free_cnt, largest;
+  unsigned failures = 0;
+  int i, j;
+
+  random_init (0);
+  start_free_cnt = count_free ();
+  for (i = 0; i < ROUND_CNT; i++) 
+    {
+      struct run *r = &runs[random_ulong () % SLOT_CNT];
+      uint64_t start;
+
+      if (r->pages != NULL) 
+        {
+          check_run (r);
+          start = rdtsc ();
+          palloc_free_multiple (r->pages, r->page_cnt);
+          record (&free_lat, start);
+          r->pages = NULL;
+          continue;
+        }
+
+      r->page_cnt = random_ulong () % MAX_RUN + 1;
+      start = rdtsc ();
+      r->pages = palloc_get_multiple (PAL_USER, r->page_cnt);
+      record (&alloc_lat, start);
+      if (r->pages == NULL) 
+        {
+          failures++;
+          continue;
+        }
+      for (j = 0; j < (int) r->page_cnt; j++)
+        *(struct run **) (r->pages + j * PGSIZE) = r;
+    }
+
+  report ("Allocate", &alloc_lat);
+  report ("Free", &free_lat);
+
+  free_cnt = count_free ();
+  largest = largest_free (free_cnt);
+  msg ("Largest free run: %zu of %zu free pages (%zu%%); "
+       "%u allocations failed.",
+       largest, free_cnt, free_cnt ? largest * 100 / free_cnt : 0, failures);
+
+  for (i = 0; i < SLOT_CNT; i++)
+    if (runs[i].pages != NULL) 
+      {
+        check_run (&runs[i]);
+        palloc_free_multiple (runs[i].pages, runs[i].page_cnt);
+      }
+  free_cnt = count_free ();
+  if (free_cnt != start_free_cnt)
+    fail ("%zu pages free at the end, but %zu at the start",
+          free_cnt, start_free_cnt);
+  msg ("All %zu free pages were given back.", free_cnt);
+  pass ();
+}
+
+/* Adds the time since START to LAT. */
+static void
+record (struct latency *lat, uint64_t start) 
+{
+  uint64_t cycles = rdtsc () - start;
+
+  lat->total += cycles;
+  if (cycles > lat->max)
+    lat->max = cycles;
+  lat->cnt++;
+}
+
+/* Prints the average and worst of LAT. */
+static void
+report (const char *what, const struct latency *lat) 
+{
+  msg ("%s: %lld ns average, %lld ns worst, over %u calls.", what,
+       clock_cycles_to_ns (lat->cnt ? lat->total / lat->cnt : 0),
+       clock_cycles_to_ns (lat->max), lat->cnt);
+}
+
+/* Checks that no other run has overwritten R's pages. */
+static void
+check_run (const struct run *r) 
+{
+  size_t i;
+
+  for (i = 0; i < r->page_cnt; i++)
+    if (*(struct run **) (r->pages + i * PGSIZE) != r)
+      fail ("page %zu of a %zu-page run was overwritten", i, r->page_cnt);
+}
+
+/* Returns the number of free pages in the user pool, by
+   allocating them all one at a time, chained through their first
+   words, and then freeing them. */
+static size_t
+count_free (void) 
+{
+  void *head = NULL, *page;
+  size_t cnt = 0;
+
+  while ((page = palloc_get_page (PAL_USER)) != NULL) 
+    {
+      *(void **) page = head;
+      head = page;
+      cnt++;
+    }
+  while (head != NULL) 
+    {
+      page = head;
+      head = *(void **) page;
+      palloc_free_page (page);
+    }
+  return cnt;
+}
+
+/* Returns the most contiguous pages, up to LIMIT, that the user
+   pool can allocate at once. */
+static size_t
+largest_free (size_t limit) 
+{
+  size_t lo = 0, hi = limit;
+
+  /* Invariant: LO pages can be allocated, HI + 1 cannot. */
+  while (lo < hi) 
+    {
+      size_t mid = lo + (hi - lo + 1) / 2;
+      void *pages = palloc_get_multiple (PAL_USER, mid);
+
+      if (pages != NULL) 
+        {
+          palloc_free_multiple (pages, mid);
+          lo = mid;
+        }
+      else
+        hi = mid - 1;
+    }
+  return lo;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-rebalance-fixed) begin
+(palloc-rebalance-fixed) Kernel pool did not take more than half of memory.
+(palloc-rebalance-fixed) User pool did not take more than half of memory.
+(palloc-rebalance-fixed) PASS
+(palloc-rebalance-fixed) end
+EOF
+pass;
@@ -0,0 +1,53 @@
+/* Checks that the kernel and user pools can each grow into more
+   than half of memory, by taking every page that each will give
+   in turn.
+
+   palloc-rebalance runs with the pools rebalanced on demand,
+   palloc-rebalance-fixed with the old fixed split, in which
+   neither can. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+
+static size_t take_all (enum palloc_flags);
+
+void
+test_palloc_rebalance (void) 
+{
+  /* Free memory starts at 1 MB. */
+  size_t half = (init_ram_pages - 256) / 2;
+  size_t kernel_cnt = take_all (0);
+  size_t user_cnt = take_all (PAL_USER);
+
+  msg ("Kernel pool %s more than half of memory.",
+       kernel_cnt > half ? "took" : "did not take");
+  msg ("User pool %s more than half of memory.",
+       user_cnt > half ? "took" : "did not take");
+  pass ();
+}
+
+/* Allocates pages with FLAGS one at a time, chained through
+   their first words, until no more are available, then frees
+   them and returns how many there were. */
+static size_t
+take_all (enum palloc_flags flags) 
+{
+  void *head = NULL, *page;
+  size_t cnt = 0;
+
+  while ((page = palloc_get_page (flags)) != NULL) 
+    {
+      *(void **) page = head;
+      head = page;
+      cnt++;
+    }
+  while (head != NULL) 
+    {
+      page = head;
+      head = *(void **) page;
+      palloc_free_page (page);
+    }
+  return cnt;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-rebalance) begin
+(palloc-rebalance) Kernel pool took more than half of memory.
+(palloc-rebalance) User pool took more than half of memory.
+(palloc-rebalance) PASS
+(palloc-rebalance) end
+EOF
+pass;
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Latency missing from output.\n"
+  if !grep (/^\(palloc-zero-off\) Zeroed page: \d+ ns average, \d+ ns worst, over \d+ calls\.$/,
+	    @output);
+fail "Test did not pass.\n"
+  if !grep (/^\(palloc-zero-off\) PASS$/, @output);
+pass;
@@ -0,0 +1,55 @@
+/* Measures how long it takes to get a zeroed page.  Sleeps for a
+   moment, so that the idle thread can stock up the user pool's
+   pre-zeroed pages, then times PAL_ZERO page allocations and
+   checks that every page really is zero.
+
+   palloc-zero runs with the default stock of pre-zeroed pages,
+   palloc-zero-off without one, so that every page is zeroed on
+   demand. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 16
+
+void
+test_palloc_zero (void) 
+{
+  uint8_t *pages[PAGE_CNT];
+  uint64_t total = 0, max = 0;
+  size_t i, j;
+
+  timer_sleep (TIMER_FREQ / 10);
+
+  for (i = 0; i < PAGE_CNT; i++) 
+    {
+      uint64_t start = rdtsc ();
+      uint64_t cycles;
+
+      pages[i] = palloc_get_page (PAL_USER | PAL_ZERO);
+      cycles = rdtsc () - start;
+      if (pages[i] == NULL)
+        fail ("out of pages after %zu allocations", i);
+      total += cycles;
+      if (cycles > max)
+        max = cycles;
+    }
+
+  for (i = 0; i < PAGE_CNT; i++) 
+    {
+      for (j = 0; j < PGSIZE; j++)
+        if (pages[i][j] != 0)
+          fail ("byte %zu of page %zu is %#x, not zero", j, i, pages[i][j]);
+      palloc_free_page (pages[i]);
+    }
+
+  msg ("Zeroed page: %lld ns average, %lld ns worst, over %d calls.",
+       clock_cycles_to_ns (total / PAGE_CNT), clock_cycles_to_ns (max),
+       PAGE_CNT);
+  pass ();
+}
@@ -0,0 +1,100 @@
+/* Measures cond_broadcast() with WAITER_CNT threads waiting at
+   mixed priorities.  The main thread broadcasts ROUND_CNT times,
+   timing each call, and reports the average cost.  The waiters
+   also check that they reacquire the lock in order of priority,
+   which cond_broadcast() and lock_release() are both responsible
+   for.
+
+   With priority-ordered wait queues a broadcast should cost time
+   linear in the number of waiters. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define WAITER_CNT 200
+#define ROUND_CNT 10
+
+static struct lock lock;
+static struct condition condition;
+static int arrived;             /* Waiters in cond_wait() this round. */
+static int last_priority;       /* Priority of the last waiter to wake. */
+static int out_of_order;        /* Waiters that woke before a higher one. */
+static struct semaphore done;
+
+static thread_func waiter;
+
+void
+test_priority_broadcast (void) 
+{
+  uint64_t cycles = 0;
+  int round;
+  int i;
+
+  /* This test does not work with the MLFQS or CFS. */
+  ASSERT (!thread_mlfqs && !thread_cfs);
+
+  lock_init (&lock);
+  cond_init (&condition);
+  sema_init (&done, 0);
+  arrived = 0;
+  out_of_order = 0;
+
+  for (i = 0; i < WAITER_CNT; i++) 
+    {
+      int priority = PRI_DEFAULT - (i * 7) % 20 - 1;
+      char name[16];
+      snprintf (name, sizeof name, "waiter %d", i);
+      thread_create (name, priority, waiter, NULL);
+    }
+
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      uint64_t start;
+
+      /* The waiters have lower priority than us, so they only
+         get to run while we sleep. */
+      while (arrived < WAITER_CNT)
+        timer_sleep (1);
+
+      lock_acquire (&lock);
+      arrived = 0;
+      last_priority = PRI_MAX;
+      start = rdtsc ();
+      cond_broadcast (&condition, &lock);
+      cycles += rdtsc () - start;
+      lock_release (&lock);
+    }
+
+  for (i = 0; i < WAITER_CNT; i++)
+    sema_down (&done);
+
+  if (out_of_order != 0)
+    fail ("%d waiters woke up out of priority order.", out_of_order);
+  msg ("Waiters woke up in priority order.");
+  msg ("%d waiters: %llu cycles per broadcast on average.",
+       WAITER_CNT, cycles / ROUND_CNT);
+}
+
+static void
+waiter (void *aux UNUSED) 
+{
+  int priority = thread_get_priority ();
+  int round;
+
+  for (round = 0; round < ROUND_CNT; round++) 
+    {
+      lock_acquire (&lock);
+      arrived++;
+      cond_wait (&condition, &lock);
+      if (priority > last_priority)
+        out_of_order++;
+      last_priority = priority;
+      lock_release (&lock);
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Waiters did not wake up in priority order.\n"
+  if !grep (/^\(priority-broadcast\) Waiters woke up in priority order\.$/,
+	    @output);
+fail "Broadcast cost missing from output.\n"
+  if !grep (/^\(priority-broadcast\) 200 waiters: \d+ cycles per broadcast on average\.$/,
+	    @output);
+pass;
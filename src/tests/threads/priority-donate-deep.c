@@ -0,0 +1,147 @@
+/* Measures the cost of priority donation in two worst cases.
+
+   First, the main thread holds LOCK_CNT locks, each with a
+   higher-priority thread waiting on it, and times
+   thread_get_priority(), which has to account for every
+   donation.
+
+   Second, CHAIN_CNT threads of increasing priority each hold a
+   lock and wait on the lock held by the one before them, the
+   first waiting on a lock held by the main thread.  A thread at
+   PRI_MAX then joins the end of the chain, and we time how long
+   it takes for its priority to be donated all the way down to the
+   main thread and for the main thread to run.
+
+   Both also check that the donated priority is the right one. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define LOCK_CNT (PRI_MAX - PRI_DEFAULT)
+#define CHAIN_CNT (PRI_MAX - PRI_DEFAULT - 1)
+#define GET_CNT 100000
+
+static struct lock locks[LOCK_CNT + 1];
+static uint64_t donate_start;
+
+static void many_locks (void);
+static void deep_chain (void);
+static thread_func waiter_thread;
+static thread_func chain_thread;
+static thread_func top_thread;
+
+void
+test_priority_donate_deep (void) 
+{
+  /* This test does not work with the MLFQS or CFS. */
+  ASSERT (!thread_mlfqs && !thread_cfs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  many_locks ();
+  deep_chain ();
+}
+
+static void
+many_locks (void) 
+{
+  uint64_t start, cycles;
+  int sum = 0;
+  int i;
+
+  for (i = 0; i < LOCK_CNT; i++) 
+    {
+      lock_init (&locks[i]);
+      lock_acquire (&locks[i]);
+    }
+  for (i = 0; i < LOCK_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "waiter %d", i);
+      thread_create (name, PRI_DEFAULT + i + 1, waiter_thread, &locks[i]);
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < GET_CNT; i++)
+    sum += thread_get_priority ();
+  cycles = rdtsc () - start;
+
+  if (sum != GET_CNT * PRI_MAX)
+    fail ("Donated priority was wrong with %d locks held.", LOCK_CNT);
+  msg ("%d locks held: %llu cycles per %d thread_get_priority() calls.",
+       LOCK_CNT, cycles, GET_CNT);
+
+  for (i = 0; i < LOCK_CNT; i++)
+    lock_release (&locks[i]);
+  if (thread_get_priority () != PRI_DEFAULT)
+    fail ("Priority was not restored after releasing %d locks.", LOCK_CNT);
+}
+
+static void
+waiter_thread (void *lock_) 
+{
+  struct lock *lock = lock_;
+
+  lock_acquire (lock);
+  lock_release (lock);
+}
+
+static void
+deep_chain (void) 
+{
+  uint64_t cycles;
+  int i;
+
+  for (i = 0; i <= CHAIN_CNT; i++)
+    lock_init (&locks[i]);
+
+  /* Thread I holds lock I and waits on lock I - 1; we hold lock 0. */
+  lock_acquire (&locks[0]);
+  for (i = 1; i <= CHAIN_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "chain %d", i);
+      thread_create (name, PRI_DEFAULT + i, chain_thread, &locks[i]);
+    }
+
+  /* The top thread preempts us, blocks on the last lock in the chain, and
+     donates its priority down to us. */
+  thread_create ("top", PRI_MAX, top_thread, &locks[CHAIN_CNT]);
+  cycles = rdtsc () - donate_start;
+
+  if (thread_get_priority () != PRI_MAX)
+    fail ("Priority %d was not donated through %d nested locks.",
+          PRI_MAX, CHAIN_CNT);
+  msg ("Donation through %d nested locks: %llu cycles.", CHAIN_CNT, cycles);
+
+  lock_release (&locks[0]);
+  if (thread_get_priority () != PRI_DEFAULT)
+    fail ("Priority was not restored after the chain finished.");
+  msg ("Chain finished.");
+}
+
+static void
+chain_thread (void *lock_) 
+{
+  struct lock *lock = lock_;
+
+  lock_acquire (lock);
+  lock_acquire (lock - 1);
+  lock_release (lock - 1);
+  lock_release (lock);
+}
+
+static void
+top_thread (void *lock_) 
+{
+  struct lock *lock = lock_;
+
+  donate_start = rdtsc ();
+  lock_acquire (lock);
+  lock_release (lock);
+}
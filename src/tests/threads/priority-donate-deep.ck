@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Many-locks measurement missing from output.\n"
+  if !grep (/^\(priority-donate-deep\) \d+ locks held: \d+ cycles per \d+ thread_get_priority\(\) calls\.$/,
+	    @output);
+fail "Nested donation measurement missing from output.\n"
+  if !grep (/^\(priority-donate-deep\) Donation through \d+ nested locks: \d+ cycles\.$/,
+	    @output);
+fail "Donation chain did not finish.\n"
+  if !grep (/^\(priority-donate-deep\) Chain finished\.$/, @output);
+pass;
@@ -0,0 +1,132 @@
+/* Measures read throughput under a readers-writer lock as the
+   number of reader threads grows, against a plain lock.  Each
+   reader repeatedly takes the lock and sleeps for one tick while
+   holding it, standing in for a read that waits on a device.
+   Under a plain lock reads are serialized, so the total rate
+   stays at about one read per tick whatever the number of
+   readers.  Under an rwlock the readers' sleeps overlap and the
+   rate should grow with the number of readers.
+
+   A writer also takes the lock every few ticks, and must get
+   through even though readers hold the lock almost all the
+   time. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define WINDOW_SECS 2
+#define WRITE_INTERVAL 5
+
+static struct rwlock rwlock;
+static struct lock lock;
+static bool use_rwlock;
+static volatile bool stop;
+static long long reads;
+static long long writes;
+static struct semaphore done;
+
+static thread_func reader;
+static thread_func writer;
+static long long measure (int reader_cnt, bool rw);
+
+void
+test_rwlock_scale (void) 
+{
+  int reader_cnt;
+
+  rwlock_init (&rwlock);
+  lock_init (&lock);
+  sema_init (&done, 0);
+
+  for (reader_cnt = 1; reader_cnt <= 8; reader_cnt *= 2) 
+    {
+      long long rw_rate, lock_rate, rw_writes;
+
+      rw_rate = measure (reader_cnt, true);
+      rw_writes = writes;
+      lock_rate = measure (reader_cnt, false);
+      if (rw_writes == 0)
+        fail ("Writer starved with %d readers.", reader_cnt);
+      msg ("%d readers: %lld reads/s with rwlock, %lld with lock.",
+           reader_cnt, rw_rate, lock_rate);
+    }
+}
+
+/* Runs READER_CNT readers and one writer for a fixed window,
+   using the rwlock if RW is true or the plain lock otherwise, and
+   returns the number of reads completed per second. */
+static long long
+measure (int reader_cnt, bool rw) 
+{
+  int i;
+
+  use_rwlock = rw;
+  stop = false;
+  reads = writes = 0;
+
+  for (i = 0; i < reader_cnt; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "read %d", i);
+      thread_create (name, PRI_DEFAULT, reader, NULL);
+    }
+  thread_create ("writer", PRI_DEFAULT, writer, NULL);
+
+  timer_sleep (WINDOW_SECS * TIMER_FREQ);
+  stop = true;
+  for (i = 0; i < reader_cnt + 1; i++)
+    sema_down (&done);
+
+  return reads / WINDOW_SECS;
+}
+
+static void
+reader (void *aux UNUSED) 
+{
+  enum intr_level old_level;
+
+  while (!stop) 
+    {
+      if (use_rwlock)
+        rwlock_acquire_read (&rwlock);
+      else
+        lock_acquire (&lock);
+
+      timer_sleep (1);
+      old_level = intr_disable ();
+      reads++;
+      intr_set_level (old_level);
+
+      if (use_rwlock)
+        rwlock_release_read (&rwlock);
+      else
+        lock_release (&lock);
+    }
+  sema_up (&done);
+}
+
+static void
+writer (void *aux UNUSED) 
+{
+  while (!stop) 
+    {
+      timer_sleep (WRITE_INTERVAL);
+      if (use_rwlock)
+        rwlock_acquire_write (&rwlock);
+      else
+        lock_acquire (&lock);
+
+      writes++;
+
+      if (use_rwlock)
+        rwlock_release_write (&rwlock);
+      else
+        lock_release (&lock);
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+foreach my $cnt (1, 2, 4, 8) {
+    fail "Measurement with $cnt readers missing from output.\n"
+      if !grep (/^\(rwlock-scale\) $cnt readers: \d+ reads\/s with rwlock, \d+ with lock\.$/,
+		@output);
+}
+pass;
@@ -0,0 +1,71 @@
+/* Checks the per-thread scheduling statistics and the run queue
+   delay histogram.  The main thread sleeps repeatedly while two
+   other threads spin, so it should see a voluntary switch and a
+   wakeup for every sleep, and the spinners should see involuntary
+   switches as they preempt each other. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SPINNER_CNT 2
+#define SLEEP_CNT 10
+
+static volatile bool stop;
+static struct semaphore done;
+
+static thread_func spinner;
+
+void
+test_sched_stats (void) 
+{
+  struct sched_stats stats;
+  unsigned hist[SCHED_HIST_BUCKETS];
+  tid_t spinner_tid;
+  unsigned delays;
+  int i;
+
+  sema_init (&done, 0);
+  stop = false;
+  for (i = 0; i < SPINNER_CNT; i++)
+    spinner_tid = thread_create ("spinner", PRI_DEFAULT, spinner, NULL);
+
+  for (i = 0; i < SLEEP_CNT; i++)
+    timer_sleep (2);
+
+  ASSERT (thread_get_sched_stats (thread_tid (), &stats, hist));
+  if (stats.voluntary_switches < SLEEP_CNT)
+    fail ("main made %u voluntary switches, expected at least %d.",
+          stats.voluntary_switches, SLEEP_CNT);
+  if (stats.wakeups < SLEEP_CNT)
+    fail ("main was woken %u times, expected at least %d.",
+          stats.wakeups, SLEEP_CNT);
+  if (stats.run_cycles == 0)
+    fail ("main has not run.");
+
+  delays = 0;
+  for (i = 0; i < SCHED_HIST_BUCKETS; i++)
+    delays += hist[i];
+  if (delays < SLEEP_CNT)
+    fail ("run queue delay histogram holds %u samples.", delays);
+
+  ASSERT (thread_get_sched_stats (spinner_tid, &stats, NULL));
+  if (stats.involuntary_switches == 0)
+    fail ("spinner was never preempted.");
+
+  stop = true;
+  for (i = 0; i < SPINNER_CNT; i++)
+    sema_down (&done);
+  pass ();
+}
+
+static void
+spinner (void *aux UNUSED) 
+{
+  while (!stop)
+    continue;
+  sema_up (&done);
+}
@@ -0,0 +1,93 @@
+/* Measures context-switch throughput.  Two threads at the same
+   priority repeatedly yield to each other while the main thread
+   sleeps for a fixed window, then the number of switches that
+   happened during the window is reported per second.
+
+   The rate is a benchmark; compare it across kernels to see the
+   per-switch cost of schedule().  The checker also verifies that
+   round-robin scheduling shared the window evenly between the
+   yielders. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define YIELDER_CNT 2
+#define WINDOW_SECS 5
+
+static volatile bool done;
+static volatile long long switch_cnt;
+static volatile long long yield_cnts[YIELDER_CNT];
+static struct semaphore finished;
+
+static thread_func yielder;
+
+void
+test_sched_switch (void) 
+{
+  long long start_cnt, end_cnt;
+  long long start_cnts[YIELDER_CNT], end_cnts[YIELDER_CNT];
+  enum intr_level old_level;
+  int64_t start;
+  int i;
+
+  done = false;
+  switch_cnt = 0;
+  sema_init (&finished, 0);
+
+  msg ("Starting %d yielding threads.", YIELDER_CNT);
+  for (i = 0; i < YIELDER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "yielder %d", i);
+      yield_cnts[i] = 0;
+      thread_create (name, thread_get_priority (), yielder,
+                     (void *) &yield_cnts[i]);
+    }
+
+  /* Let the yielders get going, then sample over a fixed window
+     that starts on a tick boundary. */
+  timer_sleep (TIMER_FREQ / 10);
+  start = timer_ticks ();
+  old_level = intr_disable ();
+  start_cnt = switch_cnt;
+  for (i = 0; i < YIELDER_CNT; i++)
+    start_cnts[i] = yield_cnts[i];
+  intr_set_level (old_level);
+  timer_sleep (WINDOW_SECS * TIMER_FREQ);
+  old_level = intr_disable ();
+  end_cnt = switch_cnt;
+  for (i = 0; i < YIELDER_CNT; i++)
+    end_cnts[i] = yield_cnts[i];
+  intr_set_level (old_level);
+  start = timer_elapsed (start);
+
+  done = true;
+  for (i = 0; i < YIELDER_CNT; i++)
+    sema_down (&finished);
+
+  for (i = 0; i < YIELDER_CNT; i++)
+    msg ("Yielder %d yielded %lld times.", i, end_cnts[i] - start_cnts[i]);
+  msg ("%lld context switches in %lld ticks.",
+       end_cnt - start_cnt, start);
+  msg ("%lld context switches per second.",
+       (end_cnt - start_cnt) * TIMER_FREQ / start);
+}
+
+static void
+yielder (void *yield_cnt_) 
+{
+  volatile long long *yield_cnt = yield_cnt_;
+
+  while (!done) 
+    {
+      thread_yield ();
+      switch_cnt++;
+      (*yield_cnt)++;
+    }
+  sema_up (&finished);
+}
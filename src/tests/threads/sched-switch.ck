@@ -0,0 +1,35 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my ($switches, $ticks, $rate, @yields);
+foreach (@output) {
+    my ($id, $cnt) = /Yielder (\d+) yielded (\d+) times\./;
+    $yields[$id] = $cnt if defined $id;
+    ($switches, $ticks) = /(\d+) context switches in (\d+) ticks\./
+      if !defined $switches;
+    ($rate) = /(\d+) context switches per second\./ if !defined $rate;
+}
+fail "Context switch rate missing from output.\n" if !defined $rate;
+fail "No context switches were measured.\n" if $rate == 0;
+fail "Window was $ticks ticks, expected 500 to 502.\n"
+  if $ticks < 500 || $ticks > 502;
+fail "Rate $rate does not match $switches switches in $ticks ticks.\n"
+  if $rate != int ($switches * 100 / $ticks);
+fail "Yield counts missing from output.\n"
+  if @yields != 2 || grep (!defined, @yields);
+fail "Yield counts $yields[0] and $yields[1] do not add up to $switches.\n"
+  if abs ($yields[0] + $yields[1] - $switches) > 2;
+
+# Equal-priority yielders alternate, so neither can get ahead of
+# the other by more than a turn or two.
+fail "Yielders ran unevenly: $yields[0] and $yields[1] yields.\n"
+  if abs ($yields[0] - $yields[1]) > 2;
+pass;
@@ -0,0 +1,121 @@
+/* Measures the cost of timer_ticks(), which reads the 64-bit
+   tick count under a seqlock, against reading a 64-bit value
+   with interrupts disabled, as timer_ticks() used to.
+
+   Then checks that seqlock readers never act on a torn update:
+   a writer thread repeatedly stores the same value into two
+   64-bit variables under a seqlock, with interrupts off, while
+   this thread reads them and checks that they agree.  Timer
+   interrupts preempt each thread in the middle of its loop, so
+   reads overlap writes. */
+
+#include <seqlock.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define READ_CNT 100000
+#define CHECK_TICKS 50
+
+static struct seqlock pair_seq;
+static volatile int64_t pair_a, pair_b;
+static volatile bool stop;
+static struct semaphore done;
+
+static thread_func writer;
+
+void
+test_seqlock_read (void) 
+{
+  volatile int64_t value = 0;
+  uint64_t start, seq_cycles, intr_cycles;
+  long long reads = 0, retries = 0;
+  int64_t t, last = 0;
+  int i;
+
+  /* Cost of a read. */
+  start = rdtsc ();
+  for (i = 0; i < READ_CNT; i++) 
+    {
+      t = timer_ticks ();
+      if (t < last)
+        fail ("timer_ticks() went backward from %lld to %lld", last, t);
+      last = t;
+    }
+  seq_cycles = rdtsc () - start;
+
+  start = rdtsc ();
+  for (i = 0; i < READ_CNT; i++) 
+    {
+      enum intr_level old_level = intr_disable ();
+      t = value;
+      intr_set_level (old_level);
+    }
+  intr_cycles = rdtsc () - start;
+
+  msg ("timer_ticks(): %lld cycles (%lld ns) per call.",
+       (long long) (seq_cycles / READ_CNT),
+       clock_cycles_to_ns (seq_cycles) / READ_CNT);
+  msg ("Read with interrupts off: %lld cycles (%lld ns) per call.",
+       (long long) (intr_cycles / READ_CNT),
+       clock_cycles_to_ns (intr_cycles) / READ_CNT);
+
+  /* Consistency under concurrent writes. */
+  seqlock_init (&pair_seq);
+  sema_init (&done, 0);
+  stop = false;
+  thread_create ("writer", PRI_DEFAULT, writer, NULL);
+
+  start = timer_ticks ();
+  while (timer_elapsed (start) < CHECK_TICKS) 
+    {
+      int64_t a, b;
+      unsigned seq;
+      bool first = true;
+
+      do 
+        {
+          if (!first)
+            retries++;
+          first = false;
+          seq = seqlock_read_begin (&pair_seq);
+          a = pair_a;
+          b = pair_b;
+        }
+      while (seqlock_read_retry (&pair_seq, seq));
+      if (a != b)
+        fail ("torn read: %lld != %lld", a, b);
+      reads++;
+    }
+  stop = true;
+  sema_down (&done);
+
+  if (reads == 0)
+    fail ("no reads completed");
+  msg ("No torn reads over %d ticks: %lld reads, %lld retried.",
+       CHECK_TICKS, reads, retries);
+  pass ();
+}
+
+/* Updates the pair until told to stop. */
+static void
+writer (void *aux UNUSED) 
+{
+  int64_t i;
+
+  for (i = 0; !stop; i++) 
+    {
+      enum intr_level old_level = intr_disable ();
+      seqlock_write_begin (&pair_seq);
+      pair_a = i;
+      pair_b = i;
+      seqlock_write_end (&pair_seq);
+      intr_set_level (old_level);
+    }
+  sema_up (&done);
+}
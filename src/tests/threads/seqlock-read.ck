@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "timer_ticks() cost missing from output.\n"
+  if !grep (/^\(seqlock-read\) timer_ticks\(\): \d+ cycles \(\d+ ns\) per call\.$/,
+	    @output);
+fail "Interrupts-off read cost missing from output.\n"
+  if !grep (/^\(seqlock-read\) Read with interrupts off: \d+ cycles \(\d+ ns\) per call\.$/,
+	    @output);
+fail "Consistency check missing from output.\n"
+  if !grep (/^\(seqlock-read\) No torn reads over \d+ ticks: \d+ reads, \d+ retried\.$/,
+	    @output);
+fail "Test did not pass.\n"
+  if !grep (/^\(seqlock-read\) PASS$/, @output);
+pass;
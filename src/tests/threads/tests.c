@@ -17,6 +17,8 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-many", test_alarm_many},
+    {"alarm-nohz", test_alarm_nohz},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -25,6 +27,8 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-broadcast", test_priority_broadcast},
+    {"priority-donate-deep", test_priority_donate_deep},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
@@ -38,6 +42,32 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-isr", test_mlfqs_isr},
+    {"sched-switch", test_sched_switch},
+    {"cfs-fair-2", test_cfs_fair_2},
+    {"cfs-fair-20", test_cfs_fair_20},
+    {"cfs-nice-2", test_cfs_nice_2},
+    {"cfs-nice-10", test_cfs_nice_10},
+    {"cfs-wakeup", test_cfs_wakeup},
+    {"sched-stats", test_sched_stats},
+    {"thread-spawn", test_thread_spawn},
+    {"rwlock-scale", test_rwlock_scale},
+    {"thread-pool", test_thread_pool},
+    {"alarm-hrsleep", test_alarm_hrsleep},
+    {"hrtimer-drift", test_hrtimer_drift},
+    {"clock-ns", test_clock_ns},
+    {"seqlock-read", test_seqlock_read},
+    {"kmem-cache", test_kmem_cache},
+    {"malloc-scale", test_malloc_scale},
+    {"palloc-frag", test_palloc_frag},
+    {"palloc-frag-buddy", test_palloc_frag},
+    {"bitmap-scan", test_bitmap_scan},
+    {"palloc-zero", test_palloc_zero},
+    {"palloc-zero-off", test_palloc_zero},
+    {"palloc-rebalance", test_palloc_rebalance},
+    {"palloc-rebalance-fixed", test_palloc_rebalance},
+    {"tlb-switch", test_tlb_switch},
+    {"tlb-switch-4k", test_tlb_switch},
   };
 
 static const char *test_name;
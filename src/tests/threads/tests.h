@@ -11,6 +11,8 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_many;
+extern test_func test_alarm_nohz;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -19,6 +21,8 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_broadcast;
+extern test_func test_priority_donate_deep;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
@@ -32,6 +36,28 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_mlfqs_isr;
+extern test_func test_sched_switch;
+extern test_func test_cfs_fair_2;
+extern test_func test_cfs_fair_20;
+extern test_func test_cfs_nice_2;
+extern test_func test_cfs_nice_10;
+extern test_func test_cfs_wakeup;
+extern test_func test_sched_stats;
+extern test_func test_thread_spawn;
+extern test_func test_rwlock_scale;
+extern test_func test_thread_pool;
+extern test_func test_alarm_hrsleep;
+extern test_func test_hrtimer_drift;
+extern test_func test_clock_ns;
+extern test_func test_seqlock_read;
+extern test_func test_kmem_cache;
+extern test_func test_malloc_scale;
+extern test_func test_palloc_frag;
+extern test_func test_bitmap_scan;
+extern test_func test_palloc_zero;
+extern test_func test_palloc_rebalance;
+extern test_func test_tlb_switch;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,99 @@
+/* Exercises the kernel worker pool: a parallel_for that fills
+   an array, a recursive fork/join computation whose tasks wait
+   on tasks they submit, and tasks that sleep, whose sleeps
+   should overlap.  Reports how long the sleeping tasks took on
+   the pool against how long they take one after another. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/pool.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ARRAY_SIZE 1000
+#define FIB_N 12
+#define SLEEP_TASKS 8
+#define SLEEP_TICKS 10
+
+static int squares[ARRAY_SIZE];
+
+static pool_for_func square;
+static pool_func fib;
+static pool_func nap;
+
+void
+test_thread_pool (void) 
+{
+  struct pool_task tasks[SLEEP_TASKS];
+  int64_t start, pooled, serial;
+  int i;
+
+  /* parallel_for. */
+  pool_parallel_for (0, ARRAY_SIZE, square, NULL);
+  for (i = 0; i < ARRAY_SIZE; i++)
+    if (squares[i] != i * i)
+      fail ("squares[%d] is %d, not %d", i, squares[i], i * i);
+  msg ("parallel_for filled %d elements.", ARRAY_SIZE);
+
+  /* Nested fork/join. */
+  {
+    struct pool_task task;
+    int result;
+
+    pool_submit (&task, fib, (void *) FIB_N);
+    result = (int) pool_wait (&task);
+    if (result != 144)
+      fail ("fib(%d) returned %d, not 144", FIB_N, result);
+    msg ("fib(%d) = %d.", FIB_N, result);
+  }
+
+  /* Overlapping sleeps. */
+  start = timer_ticks ();
+  for (i = 0; i < SLEEP_TASKS; i++)
+    pool_submit (&tasks[i], nap, NULL);
+  for (i = 0; i < SLEEP_TASKS; i++)
+    pool_wait (&tasks[i]);
+  pooled = timer_elapsed (start);
+
+  start = timer_ticks ();
+  for (i = 0; i < SLEEP_TASKS; i++)
+    nap (NULL);
+  serial = timer_elapsed (start);
+
+  msg ("%d sleeping tasks: %lld ticks pooled, %lld ticks serially.",
+       SLEEP_TASKS, pooled, serial);
+  if (pooled >= serial)
+    fail ("sleeping tasks did not overlap");
+  pass ();
+}
+
+static void
+square (int i, void *aux UNUSED) 
+{
+  squares[i] = i * i;
+}
+
+/* Computes Fibonacci number N_ by running fib(N_ - 1) as a new
+   task while computing fib(N_ - 2) itself. */
+static void *
+fib (void *n_) 
+{
+  int n = (int) n_;
+  struct pool_task task;
+  int a, b;
+
+  if (n < 2)
+    return (void *) n;
+  pool_submit (&task, fib, (void *) (n - 1));
+  b = (int) fib ((void *) (n - 2));
+  a = (int) pool_wait (&task);
+  return (void *) (a + b);
+}
+
+static void *
+nap (void *aux UNUSED) 
+{
+  timer_sleep (SLEEP_TICKS);
+  return NULL;
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "parallel_for result missing from output.\n"
+  if !grep (/^\(thread-pool\) parallel_for filled 1000 elements\.$/, @output);
+fail "Fork/join result missing from output.\n"
+  if !grep (/^\(thread-pool\) fib\(12\) = 144\.$/, @output);
+fail "Sleeping task measurement missing from output.\n"
+  if !grep (/^\(thread-pool\) 8 sleeping tasks: \d+ ticks pooled, \d+ ticks serially\.$/,
+	    @output);
+fail "Test did not pass.\n"
+  if !grep (/^\(thread-pool\) PASS$/, @output);
+pass;
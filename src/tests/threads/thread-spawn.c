@@ -0,0 +1,56 @@
+/* Measures thread creation and exit throughput.  The main thread
+   repeatedly creates a thread that exits immediately and waits for
+   it to finish, for a fixed window, then reports how many threads
+   were created per second.  Each thread's page is freed as the next
+   thread is scheduled, so after the first iteration thread_create()
+   should be served from the thread page cache.
+
+   The rate is a benchmark; compare it across kernels to see the
+   cost of thread_create() and thread_exit().  The checker also
+   verifies, from the statistics printed at power off, that the
+   thread page cache served nearly all of the creations. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define WINDOW_SECS 5
+
+static struct semaphore exited;
+
+static thread_func child;
+
+void
+test_thread_spawn (void) 
+{
+  long long spawn_cnt = 0;
+  int64_t start, end;
+
+  sema_init (&exited, 0);
+
+  /* Start the window on a tick boundary. */
+  timer_sleep (1);
+  start = timer_ticks ();
+  end = start + WINDOW_SECS * TIMER_FREQ;
+  while (timer_ticks () < end) 
+    {
+      if (thread_create ("child", thread_get_priority (), child, NULL)
+          == TID_ERROR)
+        fail ("thread_create() failed after %lld threads.", spawn_cnt);
+      sema_down (&exited);
+      spawn_cnt++;
+    }
+  end = timer_elapsed (start);
+
+  msg ("%lld threads created in %lld ticks.", spawn_cnt, end);
+  msg ("%lld threads created per second.", spawn_cnt * TIMER_FREQ / end);
+}
+
+static void
+child (void *aux UNUSED) 
+{
+  sema_up (&exited);
+}
@@ -0,0 +1,34 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+my ($hits, $misses);
+foreach (@output) {
+    ($hits, $misses) = /Thread: (\d+) page cache hits, (\d+) misses/ and last;
+}
+fail "Thread page cache statistics missing from output.\n"
+  if !defined $hits;
+
+@output = get_core_output ("run", @output);
+
+my ($spawned, $rate);
+foreach (@output) {
+    ($spawned) = /(\d+) threads created in \d+ ticks\./ if !defined $spawned;
+    ($rate) = /(\d+) threads created per second\./ if !defined $rate;
+}
+fail "Thread creation rate missing from output.\n" if !defined $rate;
+fail "No threads were created.\n" if $rate == 0 || $spawned == 0;
+
+# Each child's page is back in the cache before the next
+# thread_create(), so only the threads created at boot, and the
+# first child, should have needed a fresh page.
+fail "$spawned threads created but only $hits page cache hits.\n"
+  if $hits < $spawned - 1;
+fail "$misses page cache misses, expected at most 16.\n" if $misses > 16;
+pass;
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Kernel not mapped with 4 kB pages only.\n"
+  if !grep (/^\(tlb-switch-4k\) Kernel mapped with 4 kB pages\.$/, @output);
+fail "Timing missing from output.\n"
+  if !grep (/^\(tlb-switch-4k\) Non-global kernel pages: \d+ ns per turn\.$/,
+	    @output);
+fail "Test did not pass.\n"
+  if !grep (/^\(tlb-switch-4k\) PASS$/, @output);
+pass;
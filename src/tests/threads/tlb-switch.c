@@ -0,0 +1,101 @@
+/* Measures how process switches treat the kernel's TLB entries.
+   Two threads take turns, as two user processes making system
+   calls would: each turn reloads CR3, as activating a process's
+   page directory does, then reads a word from each of PAGE_CNT
+   pages spread across the kernel's mapping of RAM, standing in
+   for the kernel's working set in a system call, and hands over
+   to the other thread.  Reports the average time per turn with
+   global kernel pages on and, by clearing CR4.PGE, off.
+
+   tlb-switch runs with the kernel mapped by 4 MB pages where
+   possible, tlb-switch-4k with 4 kB pages only. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/loader.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define TURN_CNT 2000
+#define PAGE_CNT 64
+
+static struct semaphore turns[2];
+static struct semaphore done;
+
+static void measure (const char *what);
+static void player (void *);
+static void take_turns (int idx);
+
+void
+test_tlb_switch (void)
+{
+  msg ("Kernel mapped with %s pages.",
+       paging_large_pages ? "4 MB and 4 kB" : "4 kB");
+
+  if (paging_global_pages)
+    {
+      measure ("Global kernel pages");
+      paging_set_global (false);
+      measure ("Non-global kernel pages");
+      paging_set_global (true);
+    }
+  else
+    {
+      msg ("Global kernel pages not supported.");
+      measure ("Non-global kernel pages");
+    }
+  pass ();
+}
+
+/* Has the running thread and a new one take TURN_CNT turns each,
+   and reports the average time per turn as WHAT. */
+static void
+measure (const char *what)
+{
+  uint64_t start;
+
+  sema_init (&turns[0], 1);
+  sema_init (&turns[1], 0);
+  sema_init (&done, 0);
+  thread_create ("player", PRI_DEFAULT, player, NULL);
+
+  start = rdtsc ();
+  take_turns (0);
+  sema_down (&done);
+  msg ("%s: %lld ns per turn.", what,
+       clock_cycles_to_ns ((rdtsc () - start) / (2 * TURN_CNT)));
+}
+
+/* Second player's thread function. */
+static void
+player (void *aux UNUSED)
+{
+  take_turns (1);
+  sema_up (&done);
+}
+
+/* Takes TURN_CNT turns as player IDX. */
+static void
+take_turns (int idx)
+{
+  int i;
+
+  for (i = 0; i < TURN_CNT; i++)
+    {
+      size_t j;
+
+      sema_down (&turns[idx]);
+      paging_flush ();
+      for (j = 0; j < PAGE_CNT; j++)
+        {
+          uintptr_t paddr = (uintptr_t) (init_ram_pages * j / PAGE_CNT)
+                            * PGSIZE;
+          (void) *(volatile uint32_t *) ptov (paddr);
+        }
+      sema_up (&turns[!idx]);
+    }
+}
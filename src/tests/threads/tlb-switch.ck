@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Timing missing from output.\n"
+  if !grep (/^\(tlb-switch\) Non-global kernel pages: \d+ ns per turn\.$/,
+	    @output);
+fail "Test did not pass.\n"
+  if !grep (/^\(tlb-switch\) PASS$/, @output);
+pass;
@@ -0,0 +1,39 @@
+/*! \file cpu.h
+ *
+ * Inline functions for miscellaneous processor instructions that do not
+ * belong with port I/O or the control registers.
+ */
+
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdint.h>
+
+/*! Reads and returns the processor's 64-bit time-stamp counter, which
+ *  counts clock cycles since reset.
+ *
+ * \see [IA32-v2b] "RDTSC"
+ */
+static inline uint64_t rdtsc(void) {
+    uint64_t tsc;
+    asm volatile ("rdtsc" : "=A" (tsc));
+    return tsc;
+}
+
+/*! Feature flags returned in EDX by CPUID leaf 1. @{ */
+#define CPUID_PSE 0x00000008    /*!< 4 MB pages (CR4.PSE). */
+#define CPUID_PGE 0x00002000    /*!< Global pages (CR4.PGE). */
+/*! @} */
+
+/*! Executes CPUID with EAX set to LEAF and returns the feature flags that
+ *  it leaves in EDX.  Only meaningful for LEAF 1.
+ *
+ * \see [IA32-v2a] "CPUID"
+ */
+static inline uint32_t cpuid_edx(uint32_t leaf) {
+    uint32_t eax = leaf, ebx, ecx = 0, edx;
+    asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+    return edx;
+}
+
+#endif /* threads/cpu.h */
@@ -15,13 +15,17 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/pool.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 
 #ifdef USERPROG
 
@@ -65,6 +69,23 @@ static const char *swap_bdev_name;
 /*! -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/*! -nopse, -nopge: Map the kernel without 4 MB pages or without global
+    pages, even if the processor supports them. */
+static bool no_large_pages;
+static bool no_global_pages;
+
+/*! Paging features that paging_init() turned on. */
+bool paging_large_pages;
+bool paging_global_pages;
+
+/*! CR4 flags.  See [IA32-v3a] 2.5 "Control Registers". @{ */
+#define CR4_PSE 0x10            /*!< Page size extensions: 4 MB pages. */
+#define CR4_PGE 0x80            /*!< Page global enable. */
+/*! @} */
+
+static uint32_t cr4_read(void);
+static void cr4_write(uint32_t);
+
 static void bss_init(void);
 static void paging_init(void);
 
@@ -72,6 +93,7 @@ static char **read_command_line(void);
 static char **parse_options(char **argv);
 static void run_actions(char **argv);
 static void usage(void);
+static uint64_t parse_hz(const char *);
 
 #ifdef FILESYS
 static void locate_block_devices(void);
@@ -103,6 +125,7 @@ int main(void) {
     /* Initialize memory system. */
     palloc_init(user_page_limit);
     malloc_init();
+    kmem_init();
     paging_init();
 
     /* Segmentation. */
@@ -123,6 +146,7 @@ int main(void) {
 
     /* Start thread scheduler and enable interrupts. */
     thread_start();
+    pool_init();
     serial_init_queue();
     timer_calibrate();
 
@@ -157,12 +181,26 @@ static void bss_init(void) {
 /*! Populates the base page directory and page table with the
     kernel virtual mapping, and then sets up the CPU to use the
     new page directory.  Points init_page_dir to the page
-    directory it creates. */
+    directory it creates.
+
+    Each 4 MB region of RAM that holds no kernel text is mapped
+    with a single large page, if the processor supports them,
+    which saves both a page table and TLB entries.  The region
+    that holds the kernel text keeps 4 kB pages so that the text
+    can stay read-only.  All kernel mappings are global, if the
+    processor supports that, so that they stay in the TLB when a
+    process switch reloads CR3. */
 static void paging_init(void) {
     uint32_t *pd, *pt;
-    size_t page;
+    uint32_t features = cpuid_edx(1);
+    uint32_t global, cr4;
+    size_t page, large_cnt = 0;
     extern char _start, _end_kernel_text;
 
+    paging_large_pages = !no_large_pages && (features & CPUID_PSE) != 0;
+    paging_global_pages = !no_global_pages && (features & CPUID_PGE) != 0;
+    global = paging_global_pages ? PTE_G : 0;
+
     pd = init_page_dir = palloc_get_page(PAL_ASSERT | PAL_ZERO);
     pt = NULL;
     for (page = 0; page < init_ram_pages; page++) {
@@ -172,20 +210,74 @@ static void paging_init(void) {
         size_t pte_idx = pt_no(vaddr);
         bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+        if (paging_large_pages && pte_idx == 0
+            && page + PTSPAN / PGSIZE <= init_ram_pages
+            && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text)) {
+            pd[pde_idx] = pde_create_large(vaddr, true) | global;
+            page += PTSPAN / PGSIZE - 1;
+            large_cnt++;
+            continue;
+        }
+
         if (pd[pde_idx] == 0) {
             pt = palloc_get_page(PAL_ASSERT | PAL_ZERO);
             pd[pde_idx] = pde_create(pt);
         }
 
-        pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text);
+        pt[pte_idx] = pte_create_kernel(vaddr, !in_kernel_text) | global;
     }
 
+    /* The processor must know about large pages before it sees
+       one.  Setting CR4.PGE also flushes the whole TLB. */
+    cr4 = cr4_read();
+    if (paging_large_pages)
+        cr4 |= CR4_PSE;
+    if (paging_global_pages)
+        cr4 |= CR4_PGE;
+    cr4_write(cr4);
+
     /* Store the physical address of the page directory into CR3
        aka PDBR (page directory base register).  This activates our
        new page tables immediately.  See [IA32-v2a] "MOV--Move
        to/from Control Registers" and [IA32-v3a] 3.7.5 "Base Address
        of the Page Directory". */
-    asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
+    asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)) : "memory");
+
+    printf("Paging: %zu 4 MB pages, global kernel pages %s.\n",
+           large_cnt, paging_global_pages ? "on" : "off");
+}
+
+/*! Turns global kernel pages on or off by setting or clearing
+    CR4.PGE, which flushes the whole TLB either way.  While they
+    are off, reloading CR3 flushes kernel translations too.  Does
+    nothing unless paging_init() marked kernel pages global. */
+void paging_set_global(bool enable) {
+    uint32_t cr4;
+
+    if (!paging_global_pages)
+        return;
+    cr4 = cr4_read();
+    cr4_write(enable ? cr4 | CR4_PGE : cr4 & ~CR4_PGE);
+}
+
+/*! Reloads CR3 with its current value, flushing every TLB entry
+    that is not global, just as switching to another process's
+    page directory does. */
+void paging_flush(void) {
+    uint32_t pd;
+    asm volatile ("movl %%cr3, %0; movl %0, %%cr3" : "=r" (pd) : : "memory");
+}
+
+/*! Returns the contents of control register CR4. */
+static uint32_t cr4_read(void) {
+    uint32_t cr4;
+    asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+    return cr4;
+}
+
+/*! Stores CR4 into control register CR4. */
+static void cr4_write(uint32_t cr4) {
+    asm volatile ("movl %0, %%cr4" : : "r" (cr4) : "memory");
 }
 
 /*! Breaks the kernel command line into words and returns them as
@@ -241,6 +333,10 @@ static char ** parse_options(char **argv) {
             filesys_bdev_name = value;
         else if (!strcmp(name, "-scratch"))
             scratch_bdev_name = value;
+        else if (!strcmp(name, "-pool-extract"))
+            fsutil_pool_extract = true;
+        else if (!strcmp(name, "-time-extract"))
+            fsutil_time_extract = true;
 #ifdef VM
         else if (!strcmp(name, "-swap"))
             swap_bdev_name = value;
@@ -248,8 +344,60 @@ static char ** parse_options(char **argv) {
 #endif
         else if (!strcmp(name, "-rs"))
             random_init(atoi(value));
-        else if (!strcmp(name, "-mlfqs"))
+        else if (!strcmp(name, "-mlfqs")) {
+            /* Same as -sched=mlfqs; the last option given wins. */
             thread_mlfqs = true;
+            thread_cfs = false;
+        }
+        else if (!strcmp(name, "-sched") && value != NULL) {
+            thread_mlfqs = !strcmp(value, "mlfqs");
+            thread_cfs = !strcmp(value, "cfs");
+            if (!thread_mlfqs && !thread_cfs && strcmp(value, "rr"))
+                PANIC("unknown scheduler `%s' (use -h for help)", value);
+        }
+        else if (!strcmp(name, "-nohz"))
+            timer_nohz = true;
+        else if (!strcmp(name, "-tsc") && value != NULL)
+            timer_tsc_hz = parse_hz(value);
+        else if (!strcmp(name, "-trace"))
+            trace_enabled = true;
+#ifdef IRQSOFF_TRACE
+        else if (!strcmp(name, "-irqsoff-budget"))
+            intr_irqsoff_budget = atoi(value);
+#endif
+        else if (!strcmp(name, "-buddy") && value != NULL) {
+            if (!strcmp(value, "kernel"))
+                palloc_buddy = PALLOC_BUDDY_KERNEL;
+            else if (!strcmp(value, "user"))
+                palloc_buddy = PALLOC_BUDDY_USER;
+            else if (!strcmp(value, "all"))
+                palloc_buddy = PALLOC_BUDDY_KERNEL | PALLOC_BUDDY_USER;
+            else
+                PANIC("unknown pool `%s' (use -h for help)", value);
+        }
+        else if (!strcmp(name, "-zero-pool") && value != NULL) {
+            char *high = strchr(value, ',');
+            palloc_zero_low = atoi(value);
+            palloc_zero_high = palloc_zero_low;
+            if (high != NULL)
+                palloc_zero_high = atoi(high + 1);
+            if (palloc_zero_low > palloc_zero_high)
+                PANIC("-zero-pool low watermark above high (use -h for help)");
+        }
+        else if (!strcmp(name, "-pools") && value != NULL) {
+            char *high = strchr(value, ',');
+            palloc_fixed = !strcmp(value, "fixed");
+            if (!palloc_fixed) {
+                if (high == NULL)
+                    PANIC("bad -pools value `%s' (use -h for help)", value);
+                palloc_pool_low = atoi(value);
+                palloc_pool_high = atoi(high + 1);
+            }
+        }
+        else if (!strcmp(name, "-nopse"))
+            no_large_pages = true;
+        else if (!strcmp(name, "-nopge"))
+            no_global_pages = true;
 #ifdef USERPROG
         else if (!strcmp(name, "-ul"))
             user_page_limit = atoi(value);
@@ -271,6 +419,28 @@ static char ** parse_options(char **argv) {
     return argv;
 }
 
+/*! Parses S as a frequency in Hz, optionally followed by k, M, or G for
+    kHz, MHz, or GHz.  Panics if S is not a positive frequency. */
+static uint64_t parse_hz(const char *s) {
+    const char *p;
+    uint64_t hz = 0;
+    unsigned unit = 1;
+
+    for (p = s; *p >= '0' && *p <= '9'; p++)
+        hz = hz * 10 + (*p - '0');
+    if (*p == 'k')
+        unit = 1000;
+    else if (*p == 'M')
+        unit = 1000 * 1000;
+    else if (*p == 'G')
+        unit = 1000 * 1000 * 1000;
+    if (unit != 1)
+        p++;
+    if (*p != '\0' || hz * unit < TIMER_FREQ)
+        PANIC("bad frequency `%s' (use -h for help)", s);
+    return hz * unit;
+}
+
 /*! Runs the task specified in ARGV[1]. */
 static void run_task(char **argv) {
     const char *task = argv[1];
@@ -361,12 +531,27 @@ static void usage(void) {
            "  -f                 Format file system device during startup.\n"
            "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
            "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+           "  -pool-extract      Read ahead on the worker pool in `extract'.\n"
+           "  -time-extract      Report how long `extract' took.\n"
 #ifdef VM
            "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
 #endif
            "  -rs=SEED           Set random number seed to SEED.\n"
-           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+           "  -mlfqs             Same as -sched=mlfqs.\n"
+           "  -sched=CLASS       Use scheduler CLASS: rr (default), mlfqs, or cfs.\n"
+           "  -nohz              Stop the periodic timer tick while idle.\n"
+           "  -tsc=HZ            Skip timer calibration; the TSC runs at HZ.\n"
+           "  -trace             Record kernel events; dump them at power off.\n"
+#ifdef IRQSOFF_TRACE
+           "  -irqsoff-budget=N  Panic if interrupts stay off over N cycles.\n"
+#endif
+           "  -buddy=POOLS       Use buddy allocator for POOLS: kernel, user, or all.\n"
+           "  -zero-pool=LO,HI   Keep LO to HI pre-zeroed pages per pool; 0: none.\n"
+           "  -pools=LO,HI       Grow a pool below LO free pages, shrink above HI.\n"
+           "  -pools=fixed       Split memory evenly between the pools for good.\n"
+           "  -nopse             Map the kernel with 4 kB pages only.\n"
+           "  -nopge             Do not make kernel mappings global.\n"
 #ifdef USERPROG
            "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -9,5 +9,12 @@
 /* Page directory with kernel mappings only. */
 extern uint32_t *init_page_dir;
 
+/* Processor paging features in use. */
+extern bool paging_large_pages;   /* Kernel mapped with 4 MB pages. */
+extern bool paging_global_pages;  /* Kernel mappings are global. */
+
+void paging_set_global(bool enable);
+void paging_flush(void);
+
 #endif /* threads/init.h */
 
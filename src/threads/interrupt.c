@@ -3,11 +3,14 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "threads/work.h"
 #include "devices/timer.h"
 
 /*! Programmable Interrupt Controller (PIC) registers.
@@ -39,12 +42,38 @@ static const char *intr_names[INTR_CNT];
     is one that has no registered handler. */
 static unsigned int unexpected_cnt[INTR_CNT];
 
+#ifdef IRQSOFF_TRACE
+/*! Number of interrupts-off sites reported by intr_print_stats(). */
+#define IRQSOFF_SITES 8
+
+/*! The longest interrupts-off section seen from one disabling site. */
+struct irqsoff_site {
+    void *caller;               /*!< Return address of intr_disable(), or
+                                     the interrupt handler that ran. */
+    uint64_t max_cycles;        /*!< Longest section, in CPU cycles. */
+};
+
+/*! Interrupts-off latency tracer.
+    @{ */
+uint64_t intr_irqsoff_budget;
+static struct irqsoff_site irqsoff_sites[IRQSOFF_SITES];
+static uint64_t irqsoff_start;  /*!< TSC when interrupts went off, or 0. */
+static void *irqsoff_caller;    /*!< Who turned them off. */
+/*! @} */
+
+static void irqsoff_begin(void *caller);
+static void irqsoff_end(void);
+#endif
+
+static enum intr_level disable(void *caller);
+
 /*! External interrupts are those generated by devices outside the CPU, such as
     the timer.  External interrupts run with interrupts turned off, so they
     never nest, nor are they ever pre-empted.  Handlers for external interrupts
     also may not sleep, although they may invoke intr_yield_on_return() to
     request that a new process be scheduled just before the interrupt
-    returns. */
+    returns.  Slow work can be left to threads/work.c, which runs it with
+    interrupts on just before the interrupt returns. */
 static bool in_external_intr;   /*! Are we processing an external interrupt? */
 static bool yield_on_return;    /*! Should we yield on interrupt return? */
 
@@ -77,7 +106,8 @@ enum intr_level intr_get_level(void) {
 /*! Enables or disables interrupts as specified by LEVEL and
     returns the previous interrupt status. */
 enum intr_level intr_set_level(enum intr_level level) {
-    return level == INTR_ON ? intr_enable() : intr_disable();
+    return (level == INTR_ON ? intr_enable()
+            : disable(__builtin_return_address(0)));
 }
 
 /*! Enables interrupts and returns the previous interrupt status. */
@@ -85,6 +115,11 @@ enum intr_level intr_enable(void) {
     enum intr_level old_level = intr_get_level();
     ASSERT (!intr_context());
 
+#ifdef IRQSOFF_TRACE
+    if (old_level == INTR_OFF)
+        irqsoff_end();
+#endif
+
     /* Enable interrupts by setting the interrupt flag.
 
        See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -96,6 +131,12 @@ enum intr_level intr_enable(void) {
 
 /*! Disables interrupts and returns the previous interrupt status. */
 enum intr_level intr_disable(void) {
+    return disable(__builtin_return_address(0));
+}
+
+/*! Disables interrupts on behalf of CALLER and returns the previous
+    interrupt status. */
+static enum intr_level disable(void *caller UNUSED) {
     enum intr_level old_level = intr_get_level();
 
     /* Disable interrupts by clearing the interrupt flag.
@@ -103,6 +144,11 @@ enum intr_level intr_disable(void) {
        Hardware Interrupts". */
     asm volatile ("cli" : : : "memory");
 
+#ifdef IRQSOFF_TRACE
+    if (old_level == INTR_ON)
+        irqsoff_begin(caller);
+#endif
+
     return old_level;
 }
 
@@ -198,11 +244,12 @@ bool intr_context(void) {
     return in_external_intr;
 }
 
-/*! During processing of an external interrupt, directs the interrupt handler
-    to yield to a new process just before returning from the interrupt.  May
-    not be called at any other time. */
+/*! During processing of an external interrupt or of the deferred work that
+    follows it, directs the interrupt handler to yield to a new process just
+    before returning from the interrupt.  May not be called at any other
+    time. */
 void intr_yield_on_return(void) {
-    ASSERT(intr_context());
+    ASSERT(intr_context() || work_context());
     yield_on_return = true;
 }
 
@@ -236,6 +283,19 @@ static void pic_init(void) {
     outb(PIC1_DATA, 0x00);
 }
 
+/*! Returns true if external interrupt VEC has been raised but not yet
+    delivered, as happens while interrupts are off, by reading the PIC's
+    interrupt request register.  Interrupts must be off. */
+bool intr_pending(uint8_t vec) {
+    int ctrl = vec < 0x28 ? PIC0_CTRL : PIC1_CTRL;
+
+    ASSERT(vec >= 0x20 && vec < 0x30);
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    outb(ctrl, 0x0a);      /* OCW3: next read returns the IRR. */
+    return (inb(ctrl) & (1 << (vec & 7))) != 0;
+}
+
 /*! Sends an end-of-interrupt signal to the PIC for the given IRQ.  If we don't
     acknowledge the IRQ, it will never be delivered to us again, so this is
     important.  */
@@ -316,15 +376,38 @@ void intr_handler(struct intr_frame *frame) {
        and they need to be acknowledged on the PIC (see below).
        An external interrupt handler cannot sleep. */
     external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+#ifdef IRQSOFF_TRACE
+    /* If interrupts were on when this one arrived, any section we were
+       timing ended without intr_enable(), e.g. at the idle thread's "sti"
+       or at an "iret" into a thread that was preempted.  If the CPU turned
+       them off to deliver it, a new section starts here, charged to the
+       handler, and lasts until something turns them back on: the handler,
+       work_run(), or our "iret". */
+    if (frame->eflags & FLAG_IF) {
+        irqsoff_start = 0;
+        if (intr_get_level() == INTR_OFF)
+            irqsoff_begin(intr_handlers[frame->vec_no] != NULL
+                          ? (void *) intr_handlers[frame->vec_no]
+                          : (void *) intr_handler);
+    }
+#endif
     if (external) {
         ASSERT(intr_get_level() == INTR_OFF);
         ASSERT(!intr_context());
 
         in_external_intr = true;
-        yield_on_return = false;
+
+        /* If this interrupt arrived during deferred work, a yield may
+           already be due when the outer interrupt returns. */
+        if (!work_context())
+            yield_on_return = false;
+
+        /* If we were idling without a periodic tick, catch up first. */
+        timer_idle_exit();
     }
 
     /* Invoke the interrupt's handler. */
+    trace(TRACE_INTR_ENTER, frame->vec_no, 0);
     handler = intr_handlers[frame->vec_no];
     if (handler != NULL) {
         handler(frame);
@@ -337,6 +420,7 @@ void intr_handler(struct intr_frame *frame) {
     else {
         unexpected_interrupt(frame);
     }
+    trace(TRACE_INTR_EXIT, frame->vec_no, 0);
 
     /* Complete the processing of an external interrupt. */
     if (external) {
@@ -346,9 +430,19 @@ void intr_handler(struct intr_frame *frame) {
         in_external_intr = false;
         pic_end_of_interrupt(frame->vec_no); 
 
-        if (yield_on_return) 
+        /* Run deferred work, unless this interrupt arrived during it, in
+           which case the outer interrupt does the running and yielding. */
+        work_run();
+        if (yield_on_return && !work_context())
             thread_yield(); 
     }
+
+#ifdef IRQSOFF_TRACE
+    /* Returning restores the interrupted code's flags, turning interrupts
+       back on. */
+    if (frame->eflags & FLAG_IF)
+        irqsoff_end();
+#endif
 }
 
 /*! Handles an unexpected interrupt with interrupt frame F.  An
@@ -390,6 +484,77 @@ void intr_dump_frame(const struct intr_frame *f) {
            f->cs, f->ds, f->es, f->ss);
 }
 
+/*! Prints the longest interrupts-off sections from each of the worst
+    disabling sites.  A site is the caller of intr_disable(), or for time
+    spent handling an interrupt that arrived with interrupts on, the
+    interrupt's handler.  Pass the addresses to utils/backtrace to find the
+    functions that disabled interrupts.  Prints nothing unless the kernel
+    was built with IRQSOFF_TRACE defined. */
+void intr_print_stats(void) {
+#ifdef IRQSOFF_TRACE
+    struct irqsoff_site sites[IRQSOFF_SITES];
+    int i, j;
+
+    /* Sort a copy, longest first. */
+    enum intr_level old_level = intr_disable();
+    for (i = 0; i < IRQSOFF_SITES; i++) {
+        struct irqsoff_site site = irqsoff_sites[i];
+        for (j = i; j > 0 && sites[j - 1].max_cycles < site.max_cycles; j--)
+            sites[j] = sites[j - 1];
+        sites[j] = site;
+    }
+    intr_set_level(old_level);
+
+    printf("Interrupts off: longest sections by disabling site\n");
+    for (i = 0; i < IRQSOFF_SITES && sites[i].caller != NULL; i++)
+        printf("  %p: %"PRIu64" cycles (%"PRId64" ns)\n", sites[i].caller,
+               sites[i].max_cycles, clock_cycles_to_ns(sites[i].max_cycles));
+#endif
+}
+
+#ifdef IRQSOFF_TRACE
+/*! Starts timing an interrupts-off section.  CALLER is the return address
+    of the intr_disable() or intr_set_level() call that turned them off, or
+    the handler of the interrupt whose delivery did. */
+static void irqsoff_begin(void *caller) {
+    irqsoff_start = rdtsc();
+    irqsoff_caller = caller;
+}
+
+/*! Ends the interrupts-off section being timed, if any, and records its
+    length against its disabling site.  Each site keeps only its longest
+    section, and the table keeps only the IRQSOFF_SITES worst sites.
+    Panics if the section exceeded intr_irqsoff_budget. */
+static void irqsoff_end(void) {
+    struct irqsoff_site *site, *victim;
+    uint64_t cycles;
+
+    if (irqsoff_start == 0)
+        return;
+    cycles = rdtsc() - irqsoff_start;
+    irqsoff_start = 0;
+
+    victim = irqsoff_sites;
+    for (site = irqsoff_sites; site < irqsoff_sites + IRQSOFF_SITES; site++) {
+        if (site->caller == irqsoff_caller) {
+            victim = site;
+            break;
+        }
+        if (site->max_cycles < victim->max_cycles)
+            victim = site;
+    }
+    if (cycles > victim->max_cycles) {
+        victim->caller = irqsoff_caller;
+        victim->max_cycles = cycles;
+    }
+
+    if (intr_irqsoff_budget != 0 && cycles > intr_irqsoff_budget)
+        PANIC("interrupts off for %"PRIu64" cycles from %p, "
+              "over budget of %"PRIu64, cycles, irqsoff_caller,
+              intr_irqsoff_budget);
+}
+#endif
+
 /*! Returns the name of interrupt VEC. */
 const char * intr_name(uint8_t vec) {
     return intr_names[vec];
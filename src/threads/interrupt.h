@@ -18,6 +18,12 @@ enum intr_level intr_get_level(void);
 enum intr_level intr_set_level(enum intr_level);
 enum intr_level intr_enable(void);
 enum intr_level intr_disable(void);
+
+#ifdef IRQSOFF_TRACE
+/*! If nonzero, panic when interrupts stay disabled for longer than this
+    many CPU cycles.  Set by kernel command-line option "-irqsoff-budget". */
+extern uint64_t intr_irqsoff_budget;
+#endif
 
 /*! Interrupt stack frame. */
 struct intr_frame {
@@ -71,9 +77,11 @@ void intr_register_int(uint8_t vec, int dpl, enum intr_level,
                        intr_handler_func *, const char *name);
 bool intr_context(void);
 void intr_yield_on_return(void);
+bool intr_pending(uint8_t vec);
 
 void intr_dump_frame(const struct intr_frame *);
 const char *intr_name(uint8_t vec);
+void intr_print_stats(void);
 
 #endif /* threads/interrupt.h */
 
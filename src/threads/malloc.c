@@ -23,7 +23,17 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   Each descriptor's lock is a full `struct lock', so in front of
+   the descriptors each thread keeps a "magazine" of free blocks
+   for each size class.  malloc() takes a block from the running
+   thread's magazine and free() puts one back, with no lock at
+   all, since no other thread touches the magazine.  Only when a
+   magazine is empty does malloc() take the lock, to move half a
+   magazine's worth of blocks out of the descriptor at once, and
+   only when it is full does free() take the lock to move half of
+   it back.  A thread's magazines are emptied when it exits. */
 
 #include "threads/malloc.h"
 #include <debug.h>
@@ -33,14 +43,18 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/palloc.h"
+#include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "threads/work.h"
 
 
 /*! Descriptor. */
 struct desc {
     size_t block_size;          /*!< Size of each element in bytes. */
     size_t blocks_per_arena;    /*!< Number of blocks in an arena. */
+    unsigned mag_cap;           /*!< Most blocks in a thread's magazine. */
     struct list free_list;      /*!< List of free blocks. */
     struct lock lock;           /*!< Lock. */
 };
@@ -57,28 +71,47 @@ struct arena {
 
 /*! Free block. */
 struct block {
-    struct list_elem free_elem; /*!< Free list element. */
+    union {
+        struct list_elem free_elem; /*!< Free list element. */
+        struct block *mag_next;     /*!< Next block in a magazine. */
+    };
 };
 
 /*! Our set of descriptors. */
-static struct desc descs[10];   /*!< Descriptors. */
+static struct desc descs[MALLOC_CLASSES];       /*!< Descriptors. */
 static size_t desc_cnt;         /*!< Number of descriptors. */
 
+/*! Most bytes of free blocks in one magazine, and most blocks. */
+#define MAG_BYTES 2048
+#define MAG_MAX 16
+
+bool malloc_magazines = true;
+
+static struct block *desc_get(struct desc *);
+static void desc_put(struct desc *, struct block *);
+static void mag_refill(struct desc *, struct malloc_mag *);
+static void mag_flush(struct desc *, struct malloc_mag *, unsigned cnt);
 static struct arena *block_to_arena(struct block *);
 static struct block *arena_to_block(struct arena *, size_t idx);
 
 /*! Initializes the malloc() descriptors. */
 void malloc_init(void) {
     size_t block_size;
+    char name[16];
 
     for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
         struct desc *d = &descs[desc_cnt++];
         ASSERT(desc_cnt <= sizeof descs / sizeof *descs);
         d->block_size = block_size;
         d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+        d->mag_cap = MAG_BYTES / block_size;
+        if (d->mag_cap > MAG_MAX)
+            d->mag_cap = MAG_MAX;
         list_init(&d->free_list);
-        lock_init(&d->lock);
+        snprintf(name, sizeof name, "malloc %zu", block_size);
+        lock_init_named(&d->lock, name);
     }
+    ASSERT(desc_cnt == MALLOC_CLASSES);
 }
 
 /*! Obtains and returns a new block of at least SIZE bytes.
@@ -115,33 +148,27 @@ void * malloc(size_t size) {
         return a + 1;
     }
 
-    lock_acquire(&d->lock);
+    /* Deferred work runs on the interrupted thread's stack, with that
+       thread's magazines, and must not sleep on a descriptor lock. */
+    ASSERT(!intr_context());
+    ASSERT(!work_context());
 
-    /* If the free list is empty, create a new arena. */
-    if (list_empty (&d->free_list)) {
-        size_t i;
+    if (malloc_magazines) {
+        /* Take a block from the running thread's magazine. */
+        struct malloc_mag *m = &thread_current()->mags.mags[d - descs];
 
-        /* Allocate a page. */
-        a = palloc_get_page(0);
-        if (a == NULL) {
-            lock_release(&d->lock);
+        if (m->cnt == 0)
+            mag_refill(d, m);
+        if (m->cnt == 0)
             return NULL;
-        }
-
-        /* Initialize arena and add its blocks to the free list. */
-        a->magic = ARENA_MAGIC;
-        a->desc = d;
-        a->free_cnt = d->blocks_per_arena;
-        for (i = 0; i < d->blocks_per_arena; i++) {
-            struct block *b = arena_to_block(a, i);
-            list_push_back(&d->free_list, &b->free_elem);
-        }
+        b = m->head;
+        m->head = b->mag_next;
+        m->cnt--;
+        return b;
     }
 
-    /* Get a block from free list and return it. */
-    b = list_entry(list_pop_front (&d->free_list), struct block, free_elem);
-    a = block_to_arena(b);
-    a->free_cnt--;
+    lock_acquire(&d->lock);
+    b = desc_get(d);
     lock_release(&d->lock);
     return b;
 }
@@ -165,6 +192,18 @@ void * calloc(size_t a, size_t b) {
     return p;
 }
 
+/*! Returns the fewest pages that malloc() needs to hold CNT blocks of SIZE
+    bytes each, if no other blocks share their arenas. */
+size_t malloc_pages_needed(size_t size, size_t cnt) {
+    struct desc *d;
+
+    for (d = descs; d < descs + desc_cnt; d++) {
+        if (d->block_size >= size)
+            return DIV_ROUND_UP(cnt, d->blocks_per_arena);
+    }
+    return cnt * DIV_ROUND_UP(size + sizeof (struct arena), PGSIZE);
+}
+
 /*! Returns the number of bytes allocated for BLOCK. */
 static size_t block_size(void *block) {
     struct block *b = block;
@@ -209,29 +248,29 @@ void free(void *p) {
 
         if (d != NULL) {
             /* It's a normal block.  We handle it here. */
+            ASSERT(!intr_context());
+            ASSERT(!work_context());
 
 #ifndef NDEBUG
             /* Clear the block to help detect use-after-free bugs. */
             memset(b, 0xcc, d->block_size);
 #endif
 
-            lock_acquire(&d->lock);
-
-            /* Add block to free list. */
-            list_push_front(&d->free_list, &b->free_elem);
-
-            /* If the arena is now entirely unused, free it. */
-            if (++a->free_cnt >= d->blocks_per_arena) {
-                size_t i;
-
-                ASSERT(a->free_cnt == d->blocks_per_arena);
-                for (i = 0; i < d->blocks_per_arena; i++) {
-                    struct block *b = arena_to_block(a, i);
-                    list_remove(&b->free_elem);
-                }
-                palloc_free_page(a);
+            if (malloc_magazines) {
+                /* Put the block in the running thread's magazine, first
+                   making room if it is full. */
+                struct malloc_mag *m = &thread_current()->mags.mags[d - descs];
+
+                if (m->cnt >= d->mag_cap)
+                    mag_flush(d, m, (d->mag_cap + 1) / 2);
+                b->mag_next = m->head;
+                m->head = b;
+                m->cnt++;
+                return;
             }
 
+            lock_acquire(&d->lock);
+            desc_put(d, b);
             lock_release(&d->lock);
         }
         else {
@@ -242,6 +281,106 @@ void free(void *p) {
     }
 }
 
+/*! Returns the blocks in the running thread's magazines to their
+    descriptors.  Called by thread_exit(). */
+void malloc_thread_exit(void) {
+    struct malloc_mags *mags = &thread_current()->mags;
+    size_t i;
+
+    for (i = 0; i < desc_cnt; i++)
+        mag_flush(&descs[i], &mags->mags[i], mags->mags[i].cnt);
+}
+
+/*! Removes a block from descriptor D's free list, creating a new arena
+    if the list is empty, and returns it.  Returns a null pointer if
+    memory is not available.  D's lock must be held. */
+static struct block *desc_get(struct desc *d) {
+    struct block *b;
+    struct arena *a;
+
+    /* If the free list is empty, create a new arena. */
+    if (list_empty (&d->free_list)) {
+        size_t i;
+
+        /* Allocate a page. */
+        a = palloc_get_page(0);
+        if (a == NULL)
+            return NULL;
+
+        /* Initialize arena and add its blocks to the free list. */
+        a->magic = ARENA_MAGIC;
+        a->desc = d;
+        a->free_cnt = d->blocks_per_arena;
+        for (i = 0; i < d->blocks_per_arena; i++) {
+            struct block *b = arena_to_block(a, i);
+            list_push_back(&d->free_list, &b->free_elem);
+        }
+    }
+
+    /* Get a block from free list and return it. */
+    b = list_entry(list_pop_front (&d->free_list), struct block, free_elem);
+    a = block_to_arena(b);
+    a->free_cnt--;
+    return b;
+}
+
+/*! Adds block B to descriptor D's free list, and frees its arena if that
+    leaves the arena entirely unused.  D's lock must be held. */
+static void desc_put(struct desc *d, struct block *b) {
+    struct arena *a = block_to_arena(b);
+
+    /* Add block to free list. */
+    list_push_front(&d->free_list, &b->free_elem);
+
+    /* If the arena is now entirely unused, free it. */
+    if (++a->free_cnt >= d->blocks_per_arena) {
+        size_t i;
+
+        ASSERT(a->free_cnt == d->blocks_per_arena);
+        for (i = 0; i < d->blocks_per_arena; i++) {
+            struct block *b = arena_to_block(a, i);
+            list_remove(&b->free_elem);
+        }
+        palloc_free_page(a);
+    }
+}
+
+/*! Fills magazine M, which must be empty, with half as many blocks as it
+    holds from descriptor D, or as many as are available. */
+static void mag_refill(struct desc *d, struct malloc_mag *m) {
+    unsigned want = (d->mag_cap + 1) / 2;
+
+    ASSERT(m->cnt == 0);
+
+    lock_acquire(&d->lock);
+    while (m->cnt < want) {
+        struct block *b = desc_get(d);
+        if (b == NULL)
+            break;
+        b->mag_next = m->head;
+        m->head = b;
+        m->cnt++;
+    }
+    lock_release(&d->lock);
+}
+
+/*! Returns CNT blocks from magazine M to descriptor D. */
+static void mag_flush(struct desc *d, struct malloc_mag *m, unsigned cnt) {
+    ASSERT(cnt <= m->cnt);
+
+    if (cnt == 0)
+        return;
+
+    lock_acquire(&d->lock);
+    while (cnt-- > 0) {
+        struct block *b = m->head;
+        m->head = b->mag_next;
+        m->cnt--;
+        desc_put(d, b);
+    }
+    lock_release(&d->lock);
+}
+
 /*! Returns the arena that block B is inside. */
 static struct arena * block_to_arena(struct block *b) {
     struct arena *a = pg_round_down(b);
@@ -2,13 +2,36 @@
 #define THREADS_MALLOC_H
 
 #include <debug.h>
+#include <stdbool.h>
 #include <stddef.h>
 
+/*! Number of malloc() size classes: 16, 32, ..., 1024 bytes. */
+#define MALLOC_CLASSES 7
+
+/*! A thread's cache of free blocks of one size class. */
+struct malloc_mag {
+    void *head;                 /*!< First free block, or null. */
+    unsigned cnt;               /*!< Number of free blocks. */
+};
+
+/*! A thread's caches of free blocks, one for each size class, which let
+    malloc() and free() skip the size class's lock. */
+struct malloc_mags {
+    struct malloc_mag mags[MALLOC_CLASSES];
+};
+
+/*! If true (default), malloc() and free() go through the running
+    thread's magazines. */
+extern bool malloc_magazines;
+
 void malloc_init(void);
 void *malloc(size_t) __attribute__ ((malloc));
 void *calloc(size_t, size_t) __attribute__ ((malloc));
 void *realloc(void *, size_t);
 void free(void *);
+void malloc_thread_exit(void);
+
+size_t malloc_pages_needed(size_t size, size_t cnt);
 
 #endif /* threads/malloc.h */
 
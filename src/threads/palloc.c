@@ -8,36 +8,149 @@
    everything else.  The idea here is that the kernel needs to have memory for
    its own operations even if user processes are swapping like mad.
 
-   By default, half of system RAM is given to the kernel pool and half to the
-   user pool.  That should be huge overkill for the kernel pool, but that's
-   just fine for demonstration purposes. */
+   Each pool starts out with a quarter of system RAM.  The other half is
+   kept in a shared reserve, between the kernel pool at the bottom of memory
+   and the user pool at the top, so that a pool can grow by the pages of the
+   reserve next to it.  A pool that runs out of pages borrows a "chunk" of
+   CHUNK_PAGES from the reserve, or has the other pool give back a free
+   chunk at its edge if the reserve is empty.  The idle thread also moves
+   chunks ahead of need: it borrows a chunk for a pool with fewer free pages
+   than a low watermark, and gives one back from a pool with more than a
+   high watermark.  No pool shrinks below its starting size.  The "-pools"
+   kernel command-line option sets the watermarks, or with "-pools=fixed"
+   restores a fixed split: half of system RAM to each pool, with no reserve.
+   That should be huge overkill for the kernel pool, but that's just fine
+   for demonstration purposes.
+
+   Each pool finds free pages either by scanning its bitmap of used pages
+   (the default), starting where the previous allocation left off ("next
+   fit"), or with a binary buddy allocator, chosen per pool with
+   the "-buddy" kernel command-line option.  The buddy allocator keeps a
+   list of free blocks of each power-of-2 size ("order"), each block
+   aligned to its size relative to `base'.  A request for PAGE_CNT
+   pages takes the smallest free block of at least that size, splitting
+   larger blocks in halves as needed, and gives back the pages beyond
+   PAGE_CNT at its end.  Freed pages are merged with their free "buddy"
+   block, the other half of the block they were split from, as far as
+   possible.  Both take O(log n) steps, however fragmented the pool.  The
+   bitmap is kept up to date either way.
+
+   Each pool also keeps a stock of pages that are already zeroed, so that
+   a PAL_ZERO request for a single page, such as for a page table or a new
+   process's stack, need not zero it on the spot.  The idle thread zeroes
+   pages for the stock whenever it falls below a low watermark, until it
+   reaches a high watermark, set with the "-zero-pool" kernel command-line
+   option.  Pages in the stock count as used; if a pool runs out of free
+   pages, its stock is given back before the allocation fails. */
 
 #include "threads/palloc.h"
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
+/*! Number of buddy block orders: blocks are 1 to 2**(BUDDY_ORDERS - 1)
+    pages (4 MB). */
+#define BUDDY_ORDERS 11
+
+/*! Pages moved between a pool and the reserve at once. */
+#define CHUNK_PAGES 64
+
+/*! Most places the idle thread tries in one bitmap search, which it makes
+    with interrupts off: 32 words of the bitmap. */
+#define IDLE_SCAN_PAGES 1024
+
 /*! A memory pool. */
 struct pool {
+    const char *name;                   /*!< Name, for statistics. */
     struct lock lock;                   /*!< Mutual exclusion. */
     struct bitmap *used_map;            /*!< Bitmap of free pages. */
-    uint8_t *base;                      /*!< Base of pool. */
+    uint8_t *base;                      /*!< Base of all pools' pages. */
+
+    /*! The pool's pages are those from `lo' up to `hi', numbered from
+        `base'.  Its bitmap covers the pages of every pool, with those
+        outside its own marked used.  Changed only with interrupts off.
+        @{ */
+    size_t lo, hi;                      /*!< Range of pages owned. */
+    size_t free_cnt;                    /*!< Number of those that are free. */
+    size_t min_pages;                   /*!< Never shrink below this. */
+    size_t max_pages;                   /*!< Never grow beyond this. */
+    size_t peak_pages;                  /*!< Most pages ever owned. */
+    long long borrowed;                 /*!< Chunks taken from the reserve. */
+    long long returned;                 /*!< Chunks given back. */
+    /*! @} */
+
+    /*! Buddy allocator state, used if `buddy' is true.  Changed only with
+        interrupts off, because pages are freed while switching threads.
+        @{ */
+    bool buddy;                         /*!< Use the buddy allocator? */
+    struct list free_lists[BUDDY_ORDERS]; /*!< Free blocks of each order. */
+    uint8_t *free_order;                /*!< For each page, 1 + the order of
+                                             the free block that starts
+                                             there, or 0. */
+    /*! @} */
+
+    /*! Pre-zeroed pages, linked through their first words.  Changed only
+        with interrupts off.
+        @{ */
+    void *zero_pages;                   /*!< First page in the stock. */
+    size_t zero_cnt;                    /*!< Number of pages in the stock. */
+    bool zero_refill;                   /*!< Should idle add pages? */
+    long long zero_hits;                /*!< PAL_ZERO pages from the stock. */
+    long long zero_misses;              /*!< PAL_ZERO pages zeroed on demand. */
+    /*! @} */
 };
 
 /*! Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
-static void init_pool(struct pool *, void *base, size_t page_cnt,
-                      const char *name);
+/*! Pools that use the buddy allocator.  Controlled by kernel command-line
+    option "-buddy". */
+enum palloc_buddy palloc_buddy;
+
+/*! Low and high watermarks of each pool's stock of pre-zeroed pages.  A high
+    watermark of 0 turns the stock off.  Controlled by kernel command-line
+    option "-zero-pool". */
+size_t palloc_zero_low = 8;
+size_t palloc_zero_high = 32;
+
+/*! If true, split memory between the pools once and for all, as Pintos
+    always did, instead of keeping a reserve.  Otherwise, a pool with fewer
+    than palloc_pool_low free pages borrows from the reserve, and one with
+    more than palloc_pool_high gives pages back.  Controlled by kernel
+    command-line option "-pools". */
+bool palloc_fixed;
+size_t palloc_pool_low = 16;
+size_t palloc_pool_high = 128;
+
+static void init_pool(struct pool *, const char *name, bool buddy,
+                      uint8_t **header, uint8_t *base, size_t page_cnt,
+                      size_t lo, size_t hi, size_t max_pages);
+static size_t pool_alloc(struct pool *, size_t page_cnt, bool wait);
+static void pool_free(struct pool *, size_t page_idx, size_t page_cnt);
+static bool pool_grow(struct pool *);
+static bool pool_borrow(struct pool *);
+static bool pool_return(struct pool *, bool wait);
+static void pool_add(struct pool *, size_t lo, size_t hi);
+static void pool_remove(struct pool *, size_t lo, size_t hi);
+static void *zero_take(struct pool *);
+static size_t zero_drain(struct pool *);
 static bool page_from_pool(const struct pool *, void *page);
+static size_t buddy_alloc(struct pool *, size_t page_cnt);
+static void buddy_free(struct pool *, size_t page_idx, size_t page_cnt);
+static void buddy_carve(struct pool *, size_t page_idx, size_t page_cnt);
+static void buddy_insert(struct pool *, size_t page_idx, int order);
+static void buddy_remove(struct pool *, size_t page_idx, int order);
 
 /*! Initializes the page allocator.  At most USER_PAGE_LIMIT
     pages are put into the user pool. */
@@ -46,16 +159,48 @@ void palloc_init(size_t user_page_limit) {
     uint8_t *free_start = ptov(1024 * 1024);
     uint8_t *free_end = ptov(init_ram_pages * PGSIZE);
     size_t free_pages = (free_end - free_start) / PGSIZE;
-    size_t user_pages = free_pages / 2;
-    size_t kernel_pages;
-    if (user_pages > user_page_limit)
-        user_pages = user_page_limit;
-    kernel_pages = free_pages - user_pages;
+    bool kernel_buddy = palloc_buddy & PALLOC_BUDDY_KERNEL;
+    bool user_buddy = palloc_buddy & PALLOC_BUDDY_USER;
+    size_t header_pages, page_cnt, kernel_pages, user_pages;
+    uint8_t *header = free_start;
+
+    if (!palloc_fixed && palloc_pool_high < palloc_pool_low + CHUNK_PAGES)
+        PANIC("-pools high watermark must be at least %d above low",
+              CHUNK_PAGES);
 
-    /* Give half of memory to kernel, half to user. */
-    init_pool(&kernel_pool, free_start, kernel_pages, "kernel pool");
-    init_pool(&user_pool, free_start + kernel_pages * PGSIZE,
-              user_pages, "user pool");
+    /* We'll put each pool's used_map, and its buddy allocator's free_order
+       array if needed, at the start of free memory.  Calculate the space
+       needed and subtract it from the pages available. */
+    header_pages = DIV_ROUND_UP(2 * bitmap_buf_size(free_pages)
+                                + (kernel_buddy ? free_pages : 0)
+                                + (user_buddy ? free_pages : 0), PGSIZE);
+    if (header_pages >= free_pages)
+        PANIC("Not enough memory for page allocator bitmaps.");
+    page_cnt = free_pages - header_pages;
+
+    if (palloc_fixed) {
+        /* Give half of memory to kernel, half to user. */
+        user_pages = page_cnt / 2;
+        if (user_pages > user_page_limit)
+            user_pages = user_page_limit;
+        kernel_pages = page_cnt - user_pages;
+    }
+    else {
+        /* Give a quarter of memory to each, and keep the rest in
+           reserve. */
+        kernel_pages = user_pages = page_cnt / 4;
+        if (user_pages > user_page_limit)
+            user_pages = user_page_limit;
+    }
+
+    init_pool(&kernel_pool, "kernel pool", kernel_buddy, &header,
+              free_start + header_pages * PGSIZE, page_cnt,
+              0, kernel_pages, page_cnt);
+    init_pool(&user_pool, "user pool", user_buddy, &header,
+              free_start + header_pages * PGSIZE, page_cnt,
+              page_cnt - user_pages, page_cnt, user_page_limit);
+    if (!palloc_fixed)
+        printf("%zu pages in reserve.\n", page_cnt - kernel_pages - user_pages);
 }
 
 /*! Obtains and returns a group of PAGE_CNT contiguous free pages.
@@ -72,9 +217,23 @@ void * palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
     if (page_cnt == 0)
         return NULL;
 
-    lock_acquire(&pool->lock);
-    page_idx = bitmap_scan_and_flip(pool->used_map, 0, page_cnt, false);
-    lock_release(&pool->lock);
+    if ((flags & PAL_ZERO) && page_cnt == 1) {
+        pages = zero_take(pool);
+        if (pages != NULL)
+            return pages;
+    }
+
+    page_idx = pool_alloc(pool, page_cnt, true);
+
+    /* Under memory pressure, grow the pool, give back the pre-zeroed pages,
+       and take back the object caches' empty slabs, trying again after
+       each. */
+    while (page_idx == BITMAP_ERROR && pool_grow(pool))
+        page_idx = pool_alloc(pool, page_cnt, true);
+    if (page_idx == BITMAP_ERROR && zero_drain(pool) > 0)
+        page_idx = pool_alloc(pool, page_cnt, true);
+    if (page_idx == BITMAP_ERROR && pool == &kernel_pool && kmem_reclaim() > 0)
+        page_idx = pool_alloc(pool, page_cnt, true);
 
     if (page_idx != BITMAP_ERROR)
         pages = pool->base + PGSIZE * page_idx;
@@ -126,8 +285,7 @@ void palloc_free_multiple(void *pages, size_t page_cnt) {
     memset(pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-    ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
-    bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+    pool_free(pool, page_idx, page_cnt);
 }
 
 /*! Frees the page at PAGE. */
@@ -135,32 +293,484 @@ void palloc_free_page(void *page) {
     palloc_free_multiple(page, 1);
 }
 
-/*! Initializes pool P as starting at START and ending at END,
-    naming it NAME for debugging purposes. */
-static void init_pool(struct pool *p, void *base, size_t page_cnt,
-                      const char *name) {
-    /* We'll put the pool's used_map at its base.
-       Calculate the space needed for the bitmap
-       and subtract it from the pool's size. */
-    size_t bm_pages = DIV_ROUND_UP(bitmap_buf_size(page_cnt), PGSIZE);
-    if (bm_pages > page_cnt)
-        PANIC("Not enough memory in %s for bitmap.", name);
-    page_cnt -= bm_pages;
+/*! Zeroes a free page and adds it to the stock of a pool that is being
+    refilled.  Returns true if it did, false if no pool needed a page or one
+    could not be had without taking a lock.  Called by the idle thread with
+    interrupts on, so it must not block or hold a lock. */
+bool palloc_zero_refill(void) {
+    struct pool *pools[] = {&kernel_pool, &user_pool};
+    enum intr_level old_level;
+    size_t i, page_idx;
+    void *page;
+
+    for (i = 0; i < sizeof pools / sizeof *pools; i++) {
+        struct pool *pool = pools[i];
+
+        if (!pool->zero_refill)
+            continue;
+        page_idx = pool_alloc(pool, 1, false);
+        if (page_idx == BITMAP_ERROR) {
+            /* Don't retry on every trip through the idle loop.  The next
+               zero_take() will start the refill again, and its search will
+               go on from where this one stopped. */
+            old_level = intr_disable();
+            pool->zero_refill = false;
+            intr_set_level(old_level);
+            continue;
+        }
+
+        page = pool->base + PGSIZE * page_idx;
+        memset(page, 0, PGSIZE);
+
+        old_level = intr_disable();
+        *(void **) page = pool->zero_pages;
+        pool->zero_pages = page;
+        if (++pool->zero_cnt >= palloc_zero_high)
+            pool->zero_refill = false;
+        intr_set_level(old_level);
+        return true;
+    }
+    return false;
+}
+
+/*! Moves a chunk of pages between the reserve and a pool that has too few
+    or too many free pages.  Returns true if it did, false if no pool needed
+    it or the pool's lock was held.  Called by the idle thread with
+    interrupts on, so it must not block or hold a lock. */
+bool palloc_rebalance(void) {
+    struct pool *pools[] = {&kernel_pool, &user_pool};
+    size_t i;
+
+    if (palloc_fixed)
+        return false;
+
+    for (i = 0; i < sizeof pools / sizeof *pools; i++) {
+        struct pool *pool = pools[i];
+        size_t free_cnt = pool->free_cnt;
+
+        if (free_cnt < palloc_pool_low && pool_borrow(pool))
+            return true;
+        if (free_cnt > palloc_pool_high && pool_return(pool, false))
+            return true;
+    }
+    return false;
+}
+
+/*! Prints each pool's size and use, and its use of its pre-zeroed pages.
+    Takes no locks, so that it works while shutting down after a panic. */
+void palloc_print_stats(void) {
+    struct pool *pools[] = {&kernel_pool, &user_pool};
+    size_t i;
+
+    for (i = 0; i < sizeof pools / sizeof *pools; i++) {
+        struct pool *pool = pools[i];
+        size_t page_cnt = pool->hi - pool->lo;
+
+        printf("Palloc: %s: %zu pages, %zu in use, peak %zu pages; "
+               "%lld chunks borrowed, %lld returned\n", pool->name,
+               page_cnt, page_cnt - pool->free_cnt,
+               pool->peak_pages, pool->borrowed, pool->returned);
+        printf("Palloc: %s: %lld zeroed page hits, %lld misses, "
+               "%zu pages in stock\n", pool->name, pool->zero_hits,
+               pool->zero_misses, pool->zero_cnt);
+    }
+    if (!palloc_fixed)
+        printf("Palloc: %zu pages in reserve\n",
+               user_pool.lo - kernel_pool.hi);
+}
+
+/*! Initializes pool P, naming it NAME for debugging purposes, to hold pages
+    LO up to HI of the PAGE_CNT pages at BASE, and to grow up to MAX_PAGES
+    pages.  If BUDDY is true, the pool uses the buddy allocator.  Its bitmap,
+    and free_order array if needed, are taken from *HEADER, which is
+    advanced past them. */
+static void init_pool(struct pool *p, const char *name, bool buddy,
+                      uint8_t **header, uint8_t *base, size_t page_cnt,
+                      size_t lo, size_t hi, size_t max_pages) {
+    size_t bm_size = bitmap_buf_size(page_cnt);
+    int order;
+
+    printf("%zu pages available in %s%s.\n", hi - lo, name,
+           buddy ? " (buddy allocator)" : "");
+
+    /* Initialize the pool, owning no pages, then give it its own. */
+    p->name = name;
+    lock_init_named(&p->lock, name);
+    p->used_map = bitmap_create_in_buf(page_cnt, *header, bm_size);
+    bitmap_set_all(p->used_map, true);
+    *header += bm_size;
+    p->base = base;
+    p->free_cnt = 0;
+    p->buddy = buddy;
+    if (buddy) {
+        p->free_order = *header;
+        memset(p->free_order, 0, page_cnt);
+        *header += page_cnt;
+        for (order = 0; order < BUDDY_ORDERS; order++)
+            list_init(&p->free_lists[order]);
+    }
+    pool_add(p, lo, hi);
+    p->lo = lo;
+    p->hi = hi;
+    p->min_pages = p->peak_pages = hi - lo;
+    p->max_pages = max_pages;
+    p->borrowed = p->returned = 0;
+
+    p->zero_pages = NULL;
+    p->zero_cnt = 0;
+    p->zero_refill = palloc_zero_high > 0;
+    p->zero_hits = p->zero_misses = 0;
+}
+
+/*! Marks PAGE_CNT contiguous free pages in POOL as used and returns the
+    index of the first, or BITMAP_ERROR if there are not that many.
+
+    WAIT is false for the idle thread, which must never hold a lock: it
+    could be preempted holding it, and a thread that then waited on the lock
+    would donate priority to it.  Instead it searches the bitmap with
+    interrupts off, and returns BITMAP_ERROR if another thread holds the
+    pool's lock.  So as not to keep interrupts off for long, it searches
+    only IDLE_SCAN_PAGES pages past where the last search ended, and
+    returns BITMAP_ERROR if those are all in use; the next search goes on
+    from there. */
+static size_t pool_alloc(struct pool *pool, size_t page_cnt, bool wait) {
+    size_t page_idx = BITMAP_ERROR;
+
+    if (pool->buddy) {
+        enum intr_level old_level = intr_disable();
+        page_idx = buddy_alloc(pool, page_cnt);
+        if (page_idx != BITMAP_ERROR) {
+            ASSERT(bitmap_none(pool->used_map, page_idx, page_cnt));
+            bitmap_set_multiple(pool->used_map, page_idx, page_cnt, true);
+            pool->free_cnt -= page_cnt;
+        }
+        intr_set_level(old_level);
+    }
+    else if (wait) {
+        lock_acquire(&pool->lock);
+        page_idx = bitmap_scan_and_flip_next(pool->used_map, page_cnt, false);
+        if (page_idx != BITMAP_ERROR) {
+            enum intr_level old_level = intr_disable();
+            pool->free_cnt -= page_cnt;
+            intr_set_level(old_level);
+        }
+        lock_release(&pool->lock);
+    }
+    else {
+        enum intr_level old_level = intr_disable();
+        if (!lock_is_held(&pool->lock)) {
+            page_idx = bitmap_scan_and_flip_next_limit(pool->used_map,
+                                                       page_cnt,
+                                                       IDLE_SCAN_PAGES, false);
+            if (page_idx != BITMAP_ERROR)
+                pool->free_cnt -= page_cnt;
+        }
+        intr_set_level(old_level);
+    }
+    return page_idx;
+}
+
+/*! Marks the PAGE_CNT pages starting at PAGE_IDX in POOL as free. */
+static void pool_free(struct pool *pool, size_t page_idx, size_t page_cnt) {
+    if (pool->buddy) {
+        enum intr_level old_level = intr_disable();
+        ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
+        bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+        buddy_free(pool, page_idx, page_cnt);
+        pool->free_cnt += page_cnt;
+        intr_set_level(old_level);
+    }
+    else {
+        enum intr_level old_level;
+
+        ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
+        bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+        old_level = intr_disable();
+        pool->free_cnt += page_cnt;
+        intr_set_level(old_level);
+    }
+}
+
+/*! Makes room for more pages in POOL, by borrowing from the reserve, or if
+    the reserve is empty, by having the other pool give back a chunk first.
+    Returns true if successful, false if the pool could not grow. */
+static bool pool_grow(struct pool *pool) {
+    struct pool *other = pool == &kernel_pool ? &user_pool : &kernel_pool;
+
+    return pool_borrow(pool) || (pool_return(other, true) && pool_borrow(pool));
+}
 
-    printf("%zu pages available in %s.\n", page_cnt, name);
+/*! Moves up to CHUNK_PAGES pages from the reserve into POOL, from the end
+    of the reserve next to POOL.  Returns true if any were moved. */
+static bool pool_borrow(struct pool *pool) {
+    enum intr_level old_level = intr_disable();
+    size_t cnt = CHUNK_PAGES;
+    size_t reserve = user_pool.lo - kernel_pool.hi;
+    size_t room = pool->max_pages - (pool->hi - pool->lo);
 
-    /* Initialize the pool. */
-    lock_init(&p->lock);
-    p->used_map = bitmap_create_in_buf(page_cnt, base, bm_pages * PGSIZE);
-    p->base = base + bm_pages * PGSIZE;
+    if (cnt > reserve)
+        cnt = reserve;
+    if (cnt > room)
+        cnt = room;
+    if (cnt > 0) {
+        if (pool == &kernel_pool) {
+            pool_add(pool, pool->hi, pool->hi + cnt);
+            pool->hi += cnt;
+        }
+        else {
+            pool_add(pool, pool->lo - cnt, pool->lo);
+            pool->lo -= cnt;
+        }
+        if (pool->hi - pool->lo > pool->peak_pages)
+            pool->peak_pages = pool->hi - pool->lo;
+        pool->borrowed++;
+    }
+    intr_set_level(old_level);
+    return cnt > 0;
+}
+
+/*! Moves up to CHUNK_PAGES pages at the edge of POOL next to the reserve
+    into the reserve, if they are all free, without shrinking POOL below its
+    starting size.  Returns true if successful.
+
+    A bitmap search must not take the pages as we remove them, so we hold
+    the pool's lock, or if WAIT is false, as for the idle thread, which must
+    never hold a lock, give up if another thread holds it (see
+    pool_alloc()). */
+static bool pool_return(struct pool *pool, bool wait) {
+    enum intr_level old_level;
+    size_t cnt, lo;
+    bool success = false;
+
+    if (wait)
+        lock_acquire(&pool->lock);
+
+    old_level = intr_disable();
+    if (!wait && lock_is_held(&pool->lock)) {
+        intr_set_level(old_level);
+        return false;
+    }
+    cnt = pool->hi - pool->lo - pool->min_pages;
+    if (cnt > CHUNK_PAGES)
+        cnt = CHUNK_PAGES;
+    lo = pool == &kernel_pool ? pool->hi - cnt : pool->lo;
+    if (cnt > 0 && bitmap_none(pool->used_map, lo, cnt)) {
+        pool_remove(pool, lo, lo + cnt);
+        if (pool == &kernel_pool)
+            pool->hi -= cnt;
+        else
+            pool->lo += cnt;
+        pool->returned++;
+        success = true;
+    }
+    intr_set_level(old_level);
+
+    if (wait)
+        lock_release(&pool->lock);
+    return success;
+}
+
+/*! Gives POOL the free pages LO up to HI.  Interrupts must be off, unless
+    POOL is not yet in use. */
+static void pool_add(struct pool *pool, size_t lo, size_t hi) {
+    ASSERT(bitmap_all(pool->used_map, lo, hi - lo));
+    bitmap_set_multiple(pool->used_map, lo, hi - lo, false);
+    pool->free_cnt += hi - lo;
+    if (pool->buddy)
+        buddy_free(pool, lo, hi - lo);
+}
+
+/*! Takes the free pages LO up to HI away from POOL.  Interrupts must be
+    off. */
+static void pool_remove(struct pool *pool, size_t lo, size_t hi) {
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(bitmap_none(pool->used_map, lo, hi - lo));
+    bitmap_set_multiple(pool->used_map, lo, hi - lo, true);
+    pool->free_cnt -= hi - lo;
+    if (pool->buddy)
+        buddy_carve(pool, lo, hi - lo);
+}
+
+/*! Takes a page from POOL's stock of pre-zeroed pages and returns it, or
+    returns a null pointer if the stock is empty.  Starts refilling the
+    stock if it is below its low watermark. */
+static void *zero_take(struct pool *pool) {
+    enum intr_level old_level = intr_disable();
+    void *page = pool->zero_pages;
+
+    if (page != NULL) {
+        pool->zero_pages = *(void **) page;
+        pool->zero_cnt--;
+        pool->zero_hits++;
+    }
+    else {
+        pool->zero_misses++;
+    }
+    if (pool->zero_cnt < palloc_zero_low && palloc_zero_high > 0)
+        pool->zero_refill = true;
+    intr_set_level(old_level);
+
+    if (page != NULL)
+        *(void **) page = NULL;
+    return page;
+}
+
+/*! Returns all of the pages in POOL's stock of pre-zeroed pages to the
+    pool, and returns how many there were. */
+static size_t zero_drain(struct pool *pool) {
+    enum intr_level old_level = intr_disable();
+    void *page = pool->zero_pages;
+    size_t cnt = pool->zero_cnt;
+
+    pool->zero_pages = NULL;
+    pool->zero_cnt = 0;
+    intr_set_level(old_level);
+
+    while (page != NULL) {
+        void *next = *(void **) page;
+        pool_free(pool, pg_no(page) - pg_no(pool->base), 1);
+        page = next;
+    }
+    return cnt;
 }
 
 /*! Returns true if PAGE was allocated from POOL, false otherwise. */
 static bool page_from_pool(const struct pool *pool, void *page) {
     size_t page_no = pg_no(page);
-    size_t start_page = pg_no(pool->base);
-    size_t end_page = start_page + bitmap_size(pool->used_map);
+    size_t start_page = pg_no(pool->base) + pool->lo;
+    size_t end_page = pg_no(pool->base) + pool->hi;
 
     return page_no >= start_page && page_no < end_page;
 }
 
+
+/*! Takes a run of PAGE_CNT free pages from POOL's buddy allocator and
+    returns the index of its first page, or BITMAP_ERROR if no free block
+    is big enough.  Runs longer than the largest block, 2**(BUDDY_ORDERS -
+    1) pages, cannot be allocated.  Interrupts must be off. */
+static size_t buddy_alloc(struct pool *pool, size_t page_cnt) {
+    size_t page_idx;
+    int order, want;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    /* Find the smallest order that holds PAGE_CNT pages, then the
+       smallest free block of at least that order. */
+    for (want = 0; ((size_t) 1 << want) < page_cnt; want++)
+        if (want == BUDDY_ORDERS - 1)
+            return BITMAP_ERROR;
+    for (order = want; order < BUDDY_ORDERS; order++)
+        if (!list_empty(&pool->free_lists[order]))
+            break;
+    if (order == BUDDY_ORDERS)
+        return BITMAP_ERROR;
+
+    page_idx = pg_no(list_front(&pool->free_lists[order])) - pg_no(pool->base);
+    buddy_remove(pool, page_idx, order);
+
+    /* Split the block down to the order we want, freeing the upper
+       halves. */
+    while (order > want) {
+        order--;
+        buddy_insert(pool, page_idx + ((size_t) 1 << order), order);
+    }
+
+    /* Give back the pages past PAGE_CNT. */
+    if (page_cnt < (size_t) 1 << want)
+        buddy_free(pool, page_idx + page_cnt,
+                   ((size_t) 1 << want) - page_cnt);
+    return page_idx;
+}
+
+/*! Returns the PAGE_CNT pages starting at PAGE_IDX to POOL's buddy
+    allocator, merging them with free buddies.  Interrupts must be off. */
+static void buddy_free(struct pool *pool, size_t page_idx, size_t page_cnt) {
+    size_t page_end = bitmap_size(pool->used_map);
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (page_cnt > 0) {
+        size_t idx = page_idx;
+        int order;
+
+        /* Free the largest aligned block that starts at PAGE_IDX and
+           fits in the run. */
+        for (order = 0; order < BUDDY_ORDERS - 1; order++) {
+            size_t size = (size_t) 2 << order;
+            if (idx % size != 0 || size > page_cnt)
+                break;
+        }
+        page_idx += (size_t) 1 << order;
+        page_cnt -= (size_t) 1 << order;
+
+        /* Merge with its buddy for as long as the buddy is free. */
+        while (order < BUDDY_ORDERS - 1) {
+            size_t buddy = idx ^ ((size_t) 1 << order);
+            if (buddy + ((size_t) 1 << order) > page_end
+                || pool->free_order[buddy] != order + 1)
+                break;
+            buddy_remove(pool, buddy, order);
+            if (buddy < idx)
+                idx = buddy;
+            order++;
+        }
+        buddy_insert(pool, idx, order);
+    }
+}
+
+/*! Removes the PAGE_CNT pages starting at PAGE_IDX, which must all be
+    free, from POOL's buddy allocator, splitting the free blocks that
+    straddle either end of the range.  Interrupts must be off. */
+static void buddy_carve(struct pool *pool, size_t page_idx,
+                        size_t page_cnt) {
+    size_t page_end = page_idx + page_cnt;
+    size_t left = page_idx, right = page_end;
+    size_t i = page_idx;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    /* Remove every free block that overlaps the range, noting how far the
+       first and last of them stick out of it. */
+    while (i < page_end) {
+        size_t block;
+        int order;
+
+        for (order = 0; order < BUDDY_ORDERS; order++) {
+            block = i & ~(((size_t) 1 << order) - 1);
+            if (pool->free_order[block] == order + 1)
+                break;
+        }
+        ASSERT(order < BUDDY_ORDERS);
+        buddy_remove(pool, block, order);
+        if (block < left)
+            left = block;
+        i = block + ((size_t) 1 << order);
+    }
+    if (i > right)
+        right = i;
+
+    /* Free the parts that stick out again. */
+    buddy_free(pool, left, page_idx - left);
+    buddy_free(pool, page_end, right - page_end);
+}
+
+/*! Adds the free block of order ORDER at PAGE_IDX to POOL's free lists. */
+static void buddy_insert(struct pool *pool, size_t page_idx, int order) {
+    struct list_elem *e = (struct list_elem *) (pool->base
+                                                + page_idx * PGSIZE);
+
+    ASSERT(pool->free_order[page_idx] == 0);
+    pool->free_order[page_idx] = order + 1;
+    list_push_front(&pool->free_lists[order], e);
+}
+
+/*! Removes the free block of order ORDER at PAGE_IDX from POOL's free
+    lists. */
+static void buddy_remove(struct pool *pool, size_t page_idx, int order) {
+    struct list_elem *e = (struct list_elem *) (pool->base
+                                                + page_idx * PGSIZE);
+
+    ASSERT(pool->free_order[page_idx] == order + 1);
+    pool->free_order[page_idx] = 0;
+    list_remove(e);
+}
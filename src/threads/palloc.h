@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -11,10 +12,31 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* Pools that use the buddy allocator instead of a bitmap scan. */
+enum palloc_buddy
+  {
+    PALLOC_BUDDY_KERNEL = 001,  /* Kernel pool. */
+    PALLOC_BUDDY_USER = 002     /* User pool. */
+  };
+
+extern enum palloc_buddy palloc_buddy;
+
+/* Watermarks of each pool's stock of pre-zeroed pages. */
+extern size_t palloc_zero_low;
+extern size_t palloc_zero_high;
+
+/* Fixed split between the pools, or watermarks for rebalancing them. */
+extern bool palloc_fixed;
+extern size_t palloc_pool_low;
+extern size_t palloc_pool_high;
+
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+bool palloc_zero_refill (void);
+bool palloc_rebalance (void);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
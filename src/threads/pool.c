@@ -0,0 +1,244 @@
+/*! \file pool.c
+ *
+ * A fixed-size pool of kernel worker threads.
+ *
+ * pool_submit() queues a task and returns at once; pool_wait() blocks
+ * until the task is done and returns its result, so a struct pool_task
+ * doubles as a future.  pool_parallel_for() spreads a range of indexes
+ * over the workers and the calling thread.
+ *
+ * Each worker owns a deque of pending tasks.  A worker that submits a
+ * task pushes it on the back of its own deque and takes work from the
+ * back too, so nested fork/join runs depth first.  Other threads hand
+ * their tasks to the workers round robin.  A worker whose deque is empty
+ * steals from the front of another's.  Pintos runs on one CPU, so the
+ * pool does not add computing power; what it buys is overlap: while one
+ * worker is blocked on a disk, the others, and the tasks they can steal
+ * from it, keep going.
+ *
+ * A thread waiting in pool_wait() helps instead of sleeping when it can:
+ * it runs the awaited task itself if no worker has started it, and a
+ * waiting worker otherwise runs the newest task in its own deque.  Tasks
+ * may therefore wait on tasks they submit without tying up every worker.
+ * A waiter does not steal, because running unrelated tasks on top of a
+ * waiting one could nest without bound on a 4 kB kernel stack.
+ *
+ * The workers are created the first time a task is submitted.
+ */
+
+#include "threads/pool.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/*! A worker thread and its deque of pending tasks. */
+struct worker {
+    struct thread *thread;      /*!< The worker thread. */
+    struct list deque;          /*!< Pending tasks, newest at the back. */
+};
+
+/*! Pool state, all protected by pool_lock.
+    @{ */
+static struct lock pool_lock;
+static struct condition work_ready;     /*!< Signaled when a task is queued. */
+static struct condition task_done;      /*!< Broadcast when a task finishes. */
+static struct worker workers[POOL_WORKERS];
+static bool started;                    /*!< Have the workers been created? */
+static unsigned next_worker;            /*!< Round robin for outside tasks. */
+/*! @} */
+
+/*! A slice of a pool_parallel_for() range. */
+struct for_chunk {
+    struct pool_task task;      /*!< Task running this chunk. */
+    pool_for_func *func;        /*!< Body of the loop. */
+    void *aux;                  /*!< Argument for FUNC. */
+    int begin, end;             /*!< Indexes to run, [BEGIN, END). */
+};
+
+static thread_func worker_main NO_RETURN;
+static void start_workers(void);
+static struct worker *current_worker(void);
+static struct pool_task *take_task(struct worker *self, bool steal);
+static void run_task(struct pool_task *);
+static pool_func run_chunk;
+
+/*! Initializes the pool.  Called once at boot, before the first task is
+    submitted. */
+void pool_init(void) {
+    int i;
+
+    lock_init_named(&pool_lock, "pool");
+    cond_init(&work_ready);
+    cond_init(&task_done);
+    for (i = 0; i < POOL_WORKERS; i++)
+        list_init(&workers[i].deque);
+}
+
+/*! Queues TASK to run FUNC(AUX) on a worker thread.  Use pool_wait() to
+    wait for it and get its result. */
+void pool_submit(struct pool_task *task, pool_func *func, void *aux) {
+    struct worker *w;
+
+    ASSERT(task != NULL);
+    ASSERT(func != NULL);
+
+    task->func = func;
+    task->aux = aux;
+    task->result = NULL;
+    task->state = POOL_TASK_PENDING;
+
+    lock_acquire(&pool_lock);
+    if (!started)
+        start_workers();
+    w = current_worker();
+    if (w == NULL)
+        w = &workers[next_worker++ % POOL_WORKERS];
+    list_push_back(&w->deque, &task->elem);
+    cond_signal(&work_ready, &pool_lock);
+    lock_release(&pool_lock);
+}
+
+/*! Waits for TASK to finish and returns its result.  Runs TASK, or other
+    pending tasks, in the meantime if possible. */
+void *pool_wait(struct pool_task *task) {
+    lock_acquire(&pool_lock);
+    while (task->state != POOL_TASK_DONE) {
+        struct pool_task *t = NULL;
+
+        if (task->state == POOL_TASK_PENDING) {
+            list_remove(&task->elem);
+            t = task;
+        }
+        else {
+            t = take_task(current_worker(), false);
+        }
+
+        if (t != NULL)
+            run_task(t);
+        else
+            cond_wait(&task_done, &pool_lock);
+    }
+    lock_release(&pool_lock);
+
+    return task->result;
+}
+
+/*! Runs FUNC(I, AUX) for each I from BEGIN up to but not including END,
+    spread over the workers and the calling thread, and returns when all
+    have run.  The calls may run in any order and concurrently. */
+void pool_parallel_for(int begin, int end, pool_for_func *func, void *aux) {
+    struct for_chunk chunks[POOL_WORKERS + 1];
+    int cnt, i, n;
+
+    if (end <= begin)
+        return;
+
+    n = end - begin;
+    cnt = n < POOL_WORKERS + 1 ? n : POOL_WORKERS + 1;
+    for (i = 0; i < cnt; i++) {
+        struct for_chunk *c = &chunks[i];
+        c->func = func;
+        c->aux = aux;
+        c->begin = begin + (long long) n * i / cnt;
+        c->end = begin + (long long) n * (i + 1) / cnt;
+        if (i > 0)
+            pool_submit(&c->task, run_chunk, c);
+    }
+
+    /* Take the first chunk ourselves, then help with or wait for the
+       rest. */
+    run_chunk(&chunks[0]);
+    for (i = 1; i < cnt; i++)
+        pool_wait(&chunks[i].task);
+}
+
+/*! Creates the worker threads.  Called with pool_lock held. */
+static void start_workers(void) {
+    int i;
+
+    ASSERT(lock_held_by_current_thread(&pool_lock));
+
+    started = true;
+    for (i = 0; i < POOL_WORKERS; i++) {
+        char name[16];
+
+        snprintf(name, sizeof name, "pool %d", i);
+        if (thread_create(name, PRI_DEFAULT, worker_main, &workers[i])
+            == TID_ERROR)
+            PANIC("couldn't start pool worker %d", i);
+    }
+}
+
+/*! Returns the pool worker that is the running thread, or a null pointer if
+    it is not a worker. */
+static struct worker *current_worker(void) {
+    struct thread *cur = thread_current();
+    int i;
+
+    for (i = 0; i < POOL_WORKERS; i++) {
+        if (workers[i].thread == cur)
+            return &workers[i];
+    }
+    return NULL;
+}
+
+/*! Removes and returns a pending task: the newest in SELF's deque if SELF
+    is non-null and has one, otherwise, if STEAL is true, the oldest stolen
+    from another worker's deque.  Returns a null pointer if there is no
+    such task.  Called with pool_lock held. */
+static struct pool_task *take_task(struct worker *self, bool steal) {
+    int i;
+
+    if (self != NULL && !list_empty(&self->deque))
+        return list_entry(list_pop_back(&self->deque), struct pool_task, elem);
+    if (!steal)
+        return NULL;
+
+    for (i = 0; i < POOL_WORKERS; i++) {
+        struct worker *victim = &workers[(next_worker + i) % POOL_WORKERS];
+        if (victim != self && !list_empty(&victim->deque))
+            return list_entry(list_pop_front(&victim->deque),
+                              struct pool_task, elem);
+    }
+    return NULL;
+}
+
+/*! Runs TASK, which has been removed from its deque, and wakes whoever is
+    waiting for it.  Called with pool_lock held, which is released while
+    the task runs. */
+static void run_task(struct pool_task *task) {
+    task->state = POOL_TASK_RUNNING;
+    lock_release(&pool_lock);
+
+    task->result = task->func(task->aux);
+
+    lock_acquire(&pool_lock);
+    task->state = POOL_TASK_DONE;
+    cond_broadcast(&task_done, &pool_lock);
+}
+
+/*! Body of worker thread SELF_: runs tasks until the kernel shuts down. */
+static void worker_main(void *self_) {
+    struct worker *self = self_;
+
+    lock_acquire(&pool_lock);
+    self->thread = thread_current();
+    for (;;) {
+        struct pool_task *task = take_task(self, true);
+        if (task != NULL)
+            run_task(task);
+        else
+            cond_wait(&work_ready, &pool_lock);
+    }
+}
+
+/*! Runs a pool_parallel_for() chunk. */
+static void *run_chunk(void *chunk_) {
+    struct for_chunk *c = chunk_;
+    int i;
+
+    for (i = c->begin; i < c->end; i++)
+        c->func(i, c->aux);
+    return NULL;
+}
@@ -0,0 +1,44 @@
+/*! \file pool.h
+ *
+ * Declarations for the kernel worker thread pool.
+ */
+
+#ifndef THREADS_POOL_H
+#define THREADS_POOL_H
+
+#include <list.h>
+
+/*! Number of worker threads in the pool. */
+#define POOL_WORKERS 4
+
+/*! A function run by the pool, given auxiliary data AUX.  Its return value
+    becomes the task's result. */
+typedef void *pool_func(void *aux);
+
+/*! A function run by pool_parallel_for() for index I. */
+typedef void pool_for_func(int i, void *aux);
+
+/*! States of a pool task. */
+enum pool_task_state {
+    POOL_TASK_PENDING,          /*!< Queued, not started. */
+    POOL_TASK_RUNNING,          /*!< Being run. */
+    POOL_TASK_DONE              /*!< Finished; result is valid. */
+};
+
+/*! A task submitted to the pool, and the future for its result.  The
+    submitter owns the memory, which must stay valid until pool_wait()
+    returns. */
+struct pool_task {
+    struct list_elem elem;      /*!< Element in a worker's deque. */
+    pool_func *func;            /*!< Function to run. */
+    void *aux;                  /*!< Argument for FUNC. */
+    void *result;               /*!< FUNC's return value, once done. */
+    enum pool_task_state state; /*!< Progress of the task. */
+};
+
+void pool_init(void);
+void pool_submit(struct pool_task *, pool_func *, void *aux);
+void *pool_wait(struct pool_task *);
+void pool_parallel_for(int begin, int end, pool_for_func *, void *aux);
+
+#endif /* threads/pool.h */
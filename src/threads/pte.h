@@ -59,7 +59,9 @@ static inline uintptr_t pd_no(const void *va) {
    +------------------------------------+------------------------+
 \endverbatim
 
-    In a PDE, the physical address points to a page table.
+    In a PDE, the physical address points to a page table, unless PTE_PS
+    is set, in which case the PDE maps a whole 4 MB (PTSPAN) region
+    starting at that address, which must be 4 MB aligned.
     In a PTE, the physical address points to a data or code page.
     The important flags are listed below.
     When a PDE or PTE is not "present", the other flags are
@@ -75,6 +77,8 @@ static inline uintptr_t pd_no(const void *va) {
 #define PTE_U 0x4               /*!< 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20              /*!< 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40              /*!< 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80             /*!< 1=4 MB page, 0=page table (PDEs only). */
+#define PTE_G 0x100             /*!< 1=global, kept in the TLB across CR3 loads. */
 /*! @} */
 
 /*! Returns a PDE that points to page table PT. */
@@ -83,10 +87,20 @@ static inline uint32_t pde_create(uint32_t *pt) {
     return vtop(pt) | PTE_U | PTE_P | PTE_W;
 }
 
+/*! Returns a PDE that maps the 4 MB region starting at PAGE as a single
+    large page, usable only by the kernel.  If WRITABLE is true then the
+    region will be writable as well as readable.  The processor honors
+    such a PDE only once CR4.PSE is set. */
+static inline uint32_t pde_create_large(void *page, bool writable) {
+    ASSERT(((uintptr_t) page & (PTSPAN - 1)) == 0);
+    return vtop(page) | PTE_PS | PTE_P | (writable ? PTE_W : 0);
+}
+
 /*! Returns a pointer to the page table that page directory entry
-    PDE, which must "present", points to. */
+    PDE, which must "present" and not map a large page, points to. */
 static inline uint32_t *pde_get_pt(uint32_t pde) {
     ASSERT(pde & PTE_P);
+    ASSERT(!(pde & PTE_PS));
     return ptov(pde & PTE_ADDR);
 }
 
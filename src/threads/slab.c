@@ -0,0 +1,350 @@
+/*! \file slab.c
+
+   Object cache ("slab") allocator, for fixed-size kernel objects.
+
+   malloc() rounds every request up to a power of 2, so that a
+   536-byte `struct inode' takes a 1 kB block and only 3 of them fit
+   in a page.  An object cache is created for a single type and packs
+   objects of exactly that size, rounded up to a multiple of the
+   pointer size, into one-page "slabs": 7 inodes per page.
+
+   Each slab starts with a header and keeps its free objects on a
+   list threaded through the objects themselves.  A cache keeps its
+   slabs on three lists, by how many of their objects are in use:
+   partial slabs are allocated from first, so that objects pack into
+   as few pages as possible, then empty slabs, and only then is a
+   new page obtained from the page allocator.  When a slab becomes
+   empty it is kept for reuse, up to KMEM_EMPTY_MAX per cache; any
+   others go back to the page allocator.  Under memory pressure,
+   palloc_get_multiple() calls kmem_reclaim(), which frees every
+   cache's empty slabs.
+
+   A cache may have a constructor, which is run on each object once,
+   when its slab is created.  Objects must be freed in their
+   constructed state, and the free list link is then kept just past
+   the end of each object instead of inside it, so that freeing an
+   object does not disturb its state. */
+
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/*! Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/*! Objects are aligned to, and padded to a multiple of, this size. */
+#define KMEM_ALIGN sizeof (void *)
+
+/*! Empty slabs a cache keeps for reuse, beyond which they are freed. */
+#define KMEM_EMPTY_MAX 2
+
+/*! An object cache. */
+struct kmem_cache {
+    char name[16];              /*!< Name, for statistics. */
+    size_t obj_size;            /*!< Size of each object, as requested. */
+    size_t stride;              /*!< Distance between objects in a slab. */
+    size_t link_ofs;            /*!< Offset of the free list link. */
+    size_t objs_per_slab;       /*!< Number of objects in a slab. */
+    kmem_ctor *ctor;            /*!< Constructor, or null. */
+
+    struct lock lock;           /*!< Protects the members below. */
+    struct list partial;        /*!< Slabs with some objects in use. */
+    struct list full;           /*!< Slabs with every object in use. */
+    struct list empty;          /*!< Slabs with no object in use. */
+    size_t slab_cnt;            /*!< Slabs on all three lists. */
+    size_t empty_cnt;           /*!< Slabs on `empty'. */
+    size_t obj_cnt;             /*!< Objects in use. */
+    size_t peak_obj_cnt;        /*!< Most objects ever in use at once. */
+    size_t peak_slab_cnt;       /*!< Most slabs ever allocated at once. */
+
+    struct list_elem elem;      /*!< Element in `caches'. */
+};
+
+/*! Slab header, at the start of each slab's page. */
+struct slab {
+    unsigned magic;             /*!< Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /*!< Owning cache. */
+    struct list_elem elem;      /*!< Element in one of the cache's lists. */
+    size_t in_use;              /*!< Objects allocated from this slab. */
+    void *free;                 /*!< First free object, or null. */
+};
+
+/*! All object caches.
+    @{ */
+static struct list caches;
+static struct lock caches_lock;
+static bool kmem_ready;         /*!< Has kmem_init() run? */
+/*! @} */
+
+static struct slab *slab_create(struct kmem_cache *);
+static void slab_destroy(struct slab *);
+static void **obj_link(struct kmem_cache *, void *obj);
+static size_t shrink(struct kmem_cache *, size_t keep);
+
+/*! Initializes the object cache allocator. */
+void kmem_init(void) {
+    list_init(&caches);
+    lock_init_named(&caches_lock, "kmem caches");
+    kmem_ready = true;
+}
+
+/*! Creates and returns a cache of objects of SIZE bytes, named NAME.  If
+    CTOR is nonnull, it is called on each object when its slab is created.
+    Returns a null pointer if memory is not available. */
+struct kmem_cache *kmem_cache_create(const char *name, size_t size,
+                                     kmem_ctor *ctor) {
+    struct kmem_cache *c;
+    size_t header = ROUND_UP(sizeof (struct slab), KMEM_ALIGN);
+
+    ASSERT(kmem_ready);
+    ASSERT(size > 0);
+
+    c = malloc(sizeof *c);
+    if (c == NULL)
+        return NULL;
+
+    strlcpy(c->name, name, sizeof c->name);
+    c->obj_size = size;
+    c->ctor = ctor;
+    if (ctor != NULL) {
+        c->link_ofs = ROUND_UP(size, KMEM_ALIGN);
+        c->stride = c->link_ofs + sizeof (void *);
+    }
+    else {
+        c->link_ofs = 0;
+        c->stride = ROUND_UP(size, KMEM_ALIGN);
+    }
+    c->objs_per_slab = (PGSIZE - header) / c->stride;
+    ASSERT(c->objs_per_slab > 0);
+
+    /* Not lock_init_named(): a named lock must never be freed. */
+    lock_init(&c->lock);
+    list_init(&c->partial);
+    list_init(&c->full);
+    list_init(&c->empty);
+    c->slab_cnt = c->empty_cnt = 0;
+    c->obj_cnt = c->peak_obj_cnt = c->peak_slab_cnt = 0;
+
+    lock_acquire(&caches_lock);
+    list_push_back(&caches, &c->elem);
+    lock_release(&caches_lock);
+    return c;
+}
+
+/*! Allocates and returns an object from cache C.  Returns a null pointer
+    if memory is not available. */
+void *kmem_cache_alloc(struct kmem_cache *c) {
+    struct slab *s;
+    void *obj;
+
+    lock_acquire(&c->lock);
+    if (list_empty(&c->partial) && list_empty(&c->empty)) {
+        /* Grow the cache.  The page allocator may call kmem_reclaim(),
+           which needs our lock. */
+        lock_release(&c->lock);
+        s = slab_create(c);
+        if (s == NULL)
+            return NULL;
+        lock_acquire(&c->lock);
+        list_push_front(&c->empty, &s->elem);
+        c->empty_cnt++;
+        if (++c->slab_cnt > c->peak_slab_cnt)
+            c->peak_slab_cnt = c->slab_cnt;
+    }
+
+    if (!list_empty(&c->partial)) {
+        s = list_entry(list_front(&c->partial), struct slab, elem);
+    }
+    else {
+        s = list_entry(list_pop_front(&c->empty), struct slab, elem);
+        c->empty_cnt--;
+        list_push_front(&c->partial, &s->elem);
+    }
+
+    obj = s->free;
+    s->free = *obj_link(c, obj);
+    if (++s->in_use == c->objs_per_slab) {
+        list_remove(&s->elem);
+        list_push_front(&c->full, &s->elem);
+    }
+    if (++c->obj_cnt > c->peak_obj_cnt)
+        c->peak_obj_cnt = c->obj_cnt;
+    lock_release(&c->lock);
+    return obj;
+}
+
+/*! Frees OBJ, which must have been allocated from cache C.  If C has a
+    constructor, OBJ must be in its constructed state. */
+void kmem_cache_free(struct kmem_cache *c, void *obj) {
+    struct slab *s;
+
+    if (obj == NULL)
+        return;
+
+    s = pg_round_down(obj);
+    ASSERT(s->magic == SLAB_MAGIC);
+    ASSERT(s->cache == c);
+    ASSERT((pg_ofs(obj) - ROUND_UP(sizeof *s, KMEM_ALIGN)) % c->stride == 0);
+
+#ifndef NDEBUG
+    /* Clear the object to help detect use-after-free bugs, unless that
+       would destroy its constructed state. */
+    if (c->ctor == NULL)
+        memset(obj, 0xcc, c->obj_size);
+#endif
+
+    lock_acquire(&c->lock);
+    *obj_link(c, obj) = s->free;
+    s->free = obj;
+    c->obj_cnt--;
+    if (s->in_use-- == c->objs_per_slab) {
+        list_remove(&s->elem);
+        list_push_front(&c->partial, &s->elem);
+    }
+    if (s->in_use == 0) {
+        list_remove(&s->elem);
+        list_push_front(&c->empty, &s->elem);
+        c->empty_cnt++;
+        shrink(c, KMEM_EMPTY_MAX);
+    }
+    lock_release(&c->lock);
+}
+
+/*! Destroys cache C, which must have no objects in use. */
+void kmem_cache_destroy(struct kmem_cache *c) {
+    if (c == NULL)
+        return;
+
+    lock_acquire(&caches_lock);
+    list_remove(&c->elem);
+    lock_release(&caches_lock);
+
+    lock_acquire(&c->lock);
+    ASSERT(c->obj_cnt == 0);
+    shrink(c, 0);
+    ASSERT(c->slab_cnt == 0);
+    lock_release(&c->lock);
+    free(c);
+}
+
+/*! Returns the empty slabs of cache C to the page allocator.  Returns the
+    number of pages freed. */
+size_t kmem_cache_shrink(struct kmem_cache *c) {
+    size_t freed;
+
+    lock_acquire(&c->lock);
+    freed = shrink(c, 0);
+    lock_release(&c->lock);
+    return freed;
+}
+
+/*! Returns the empty slabs of every cache to the page allocator, and
+    returns the number of pages freed.  Called by the page allocator when
+    it runs out of kernel pages. */
+size_t kmem_reclaim(void) {
+    struct list_elem *e;
+    size_t freed = 0;
+
+    if (!kmem_ready)
+        return 0;
+
+    lock_acquire(&caches_lock);
+    for (e = list_begin(&caches); e != list_end(&caches); e = list_next(e))
+        freed += kmem_cache_shrink(list_entry(e, struct kmem_cache, elem));
+    lock_release(&caches_lock);
+    return freed;
+}
+
+/*! Prints each cache's use of memory, and the memory it saves over
+    malloc().  Savings are counted when each cache's use was at its peak,
+    against the fewest pages malloc() could have packed the same objects
+    into.  Takes no locks, so that it works while shutting down after a
+    panic. */
+void kmem_print_stats(void) {
+    struct list_elem *e;
+    size_t saved = 0;
+
+    if (!kmem_ready || list_empty(&caches))
+        return;
+
+    for (e = list_begin(&caches); e != list_end(&caches); e = list_next(e)) {
+        struct kmem_cache *c = list_entry(e, struct kmem_cache, elem);
+        size_t malloc_pages = malloc_pages_needed(c->obj_size,
+                                                  c->peak_obj_cnt);
+
+        printf("Slab %s: %zu-byte objects, %zu in use in %zu pages, "
+               "peak %zu in %zu pages (malloc: %zu pages)\n",
+               c->name, c->obj_size, c->obj_cnt, c->slab_cnt,
+               c->peak_obj_cnt, c->peak_slab_cnt, malloc_pages);
+        if (malloc_pages > c->peak_slab_cnt)
+            saved += malloc_pages - c->peak_slab_cnt;
+    }
+    printf("Slab: %zu kB saved over malloc at peak use\n",
+           saved * PGSIZE / 1024);
+}
+
+/*! Allocates a new slab for cache C and constructs its objects.  Returns
+    a null pointer if no page is available. */
+static struct slab *slab_create(struct kmem_cache *c) {
+    struct slab *s = palloc_get_page(0);
+    uint8_t *obj;
+    size_t i;
+
+    if (s == NULL)
+        return NULL;
+
+    s->magic = SLAB_MAGIC;
+    s->cache = c;
+    s->in_use = 0;
+    s->free = NULL;
+
+    /* Build the free list back to front, so that objects are handed out
+       in address order. */
+    obj = (uint8_t *) s + ROUND_UP(sizeof *s, KMEM_ALIGN);
+    for (i = c->objs_per_slab; i-- > 0; ) {
+        void *o = obj + i * c->stride;
+        if (c->ctor != NULL)
+            c->ctor(o);
+        *obj_link(c, o) = s->free;
+        s->free = o;
+    }
+    return s;
+}
+
+/*! Returns slab S's page to the page allocator. */
+static void slab_destroy(struct slab *s) {
+    ASSERT(s->in_use == 0);
+    s->magic = 0;
+    palloc_free_page(s);
+}
+
+/*! Returns the location of free object OBJ's free list link. */
+static void **obj_link(struct kmem_cache *c, void *obj) {
+    return (void **) ((uint8_t *) obj + c->link_ofs);
+}
+
+/*! Frees cache C's empty slabs beyond the first KEEP.  Returns the number
+    of pages freed.  C's lock must be held. */
+static size_t shrink(struct kmem_cache *c, size_t keep) {
+    size_t freed = 0;
+
+    ASSERT(lock_held_by_current_thread(&c->lock));
+
+    while (c->empty_cnt > keep) {
+        struct slab *s = list_entry(list_pop_back(&c->empty), struct slab,
+                                    elem);
+        c->empty_cnt--;
+        c->slab_cnt--;
+        slab_destroy(s);
+        freed++;
+    }
+    return freed;
+}
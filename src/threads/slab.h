@@ -0,0 +1,32 @@
+/*! \file slab.h
+ *
+ * Declarations for the object cache (slab) allocator.
+ */
+
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/*! A cache of fixed-size objects of one type.  Opaque. */
+struct kmem_cache;
+
+/*! Constructor: puts OBJ, a new object of the cache's type, into its
+    constructed state.  Called once per object when its slab is created,
+    not on every allocation, so objects must be freed back to the cache
+    in the constructed state. */
+typedef void kmem_ctor(void *obj);
+
+void kmem_init(void);
+
+struct kmem_cache *kmem_cache_create(const char *name, size_t size,
+                                     kmem_ctor *);
+void *kmem_cache_alloc(struct kmem_cache *);
+void kmem_cache_free(struct kmem_cache *, void *);
+void kmem_cache_destroy(struct kmem_cache *);
+size_t kmem_cache_shrink(struct kmem_cache *);
+
+size_t kmem_reclaim(void);
+void kmem_print_stats(void);
+
+#endif /* threads/slab.h */
@@ -36,6 +36,19 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#ifdef LOCK_PROFILE
+#include "threads/cpu.h"
+#include "devices/timer.h"
+#endif
+
+#ifdef LOCK_PROFILE
+/*! Every lock initialized with lock_init_named(). */
+static struct list named_locks = LIST_INITIALIZER(named_locks);
+
+static bool lock_profile_more_wait(const struct list_elem *,
+                                   const struct list_elem *, void *aux);
+#endif
 
 /*! Initializes semaphore SEMA to VALUE.  A semaphore is a
     nonnegative integer along with two atomic operators for
@@ -50,7 +63,10 @@ void sema_init(struct semaphore *sema, unsigned value) {
     ASSERT(sema != NULL);
 
     sema->value = value;
-    list_init(&sema->waiters);
+    rb_init(&sema->waiters, waiting_pri_higher, NULL);
+#ifdef LOCK_PROFILE
+    sema->profile = NULL;
+#endif
 }
 
 /*! Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -67,11 +83,36 @@ void sema_down(struct semaphore *sema) {
     ASSERT(!intr_context());
 
     old_level = intr_disable();
+    trace(TRACE_SEMA_DOWN, (uint32_t) sema, sema->value);
+#ifdef LOCK_PROFILE
+    struct lock_profile *profile = sema->profile;
+    uint64_t wait_start = 0;
+    if (profile != NULL) {
+        profile->acquisitions++;
+        if (sema->value == 0) {
+            profile->contended++;
+            wait_start = rdtsc();
+        }
+    }
+#endif
     while (sema->value == 0) {
-        list_push_back(&sema->waiters, &thread_current()->semaelem);
+        struct thread *cur = thread_current();
+
+        cur->wait_priority = thread_get_priority();
+        cur->sema_waiton = sema;
+        rb_insert(&sema->waiters, &cur->semaelem);
         thread_block();
     }
     sema->value--;
+#ifdef LOCK_PROFILE
+    if (wait_start != 0) {
+        uint64_t wait = rdtsc() - wait_start;
+        profile->wait_cycles += wait;
+        if (wait > profile->max_wait_cycles) {
+            profile->max_wait_cycles = wait;
+        }
+    }
+#endif
     intr_set_level(old_level);
 }
 
@@ -110,11 +151,17 @@ void sema_up(struct semaphore *sema) {
 
     old_level = intr_disable();
     sema->value++;
-    if (!list_empty(&sema->waiters)) {
-        list_sort(&sema->waiters, waiting_pri_higher, NULL);
-        thread_unblock(
-            list_entry(
-                list_pop_front(&sema->waiters), struct thread, semaelem));
+    if (!rb_empty(&sema->waiters)) {
+        struct rb_elem *e = rb_min(&sema->waiters);
+        struct thread *t = rb_entry(e, struct thread, semaelem);
+
+        rb_remove(&sema->waiters, e);
+        t->sema_waiton = NULL;
+        trace(TRACE_SEMA_UP, (uint32_t) sema, t->tid);
+        thread_unblock(t);
+    }
+    else {
+        trace(TRACE_SEMA_UP, (uint32_t) sema, 0);
     }
     intr_set_level(old_level);
 }
@@ -173,6 +220,64 @@ void lock_init(struct lock *lock) {
     sema_init(&lock->semaphore, 1);
 }
 
+/*! Initializes LOCK like lock_init(), and names it NAME for the lock
+    contention profile printed by lock_print_stats().  Only does anything
+    more than lock_init() in kernels built with LOCK_PROFILE defined.  A
+    named lock must never be freed, so this is meant for locks with static
+    storage duration or in structures that live as long as the kernel. */
+void lock_init_named(struct lock *lock, const char *name UNUSED) {
+    lock_init(lock);
+
+#ifdef LOCK_PROFILE
+    struct lock_profile *profile = &lock->profile;
+    enum intr_level old_level;
+
+    memset(profile, 0, sizeof *profile);
+    strlcpy(profile->name, name, sizeof profile->name);
+    lock->semaphore.profile = profile;
+
+    old_level = intr_disable();
+    list_push_back(&named_locks, &profile->elem);
+    intr_set_level(old_level);
+#endif
+}
+
+/*! Prints the contention statistics of every named lock, those waited on
+    longest first.  Prints nothing unless the kernel was built with
+    LOCK_PROFILE defined. */
+void lock_print_stats(void) {
+#ifdef LOCK_PROFILE
+    struct list_elem *e;
+    enum intr_level old_level = intr_disable();
+
+    list_sort(&named_locks, lock_profile_more_wait, NULL);
+    intr_set_level(old_level);
+
+    for (e = list_begin(&named_locks); e != list_end(&named_locks);
+         e = list_next(e)) {
+        struct lock_profile *p = list_entry(e, struct lock_profile, elem);
+        printf("Lock %s: %llu acquisitions, %llu contended, "
+               "%lld ns waiting (max %lld), %lld ns held\n",
+               p->name, p->acquisitions, p->contended,
+               clock_cycles_to_ns(p->wait_cycles),
+               clock_cycles_to_ns(p->max_wait_cycles),
+               clock_cycles_to_ns(p->hold_cycles));
+    }
+#endif
+}
+
+#ifdef LOCK_PROFILE
+/*! Orders lock profiles by total wait time, longest first. */
+static bool lock_profile_more_wait(const struct list_elem *a_,
+                                   const struct list_elem *b_,
+                                   void *aux UNUSED) {
+    const struct lock_profile *a = list_entry(a_, struct lock_profile, elem);
+    const struct lock_profile *b = list_entry(b_, struct lock_profile, elem);
+
+    return a->wait_cycles > b->wait_cycles;
+}
+#endif
+
 /*! Acquires LOCK, sleeping until it becomes available if
     necessary.  The lock must not already be held by the current
     thread.
@@ -191,7 +296,7 @@ void lock_acquire(struct lock *lock) {
     struct thread *t = thread_current();
 
     // Donate priority to the lock's holder by giving it to the lock.
-    if (!get_mlfqs()) {
+    if (!get_mlfqs() && !get_cfs()) {
         donate_priority(lock, thread_get_priority());
     }
 
@@ -212,6 +317,9 @@ void lock_acquire(struct lock *lock) {
 
     // Keep track of all locks held by a thread.
     list_push_back(&t->locks, &lock->elem);
+#ifdef LOCK_PROFILE
+    lock->profile.acquired_at = rdtsc();
+#endif
 
     intr_set_level(old_level);
 }
@@ -225,28 +333,34 @@ void lock_acquire(struct lock *lock) {
     "parent" thread in the comments below, we would mean any thread that is
     waiting on a lock that is held by you or any other "parent" thread. */
 void donate_priority(struct lock *lock, int priority) {
-    // Check to see if we can help free the lock faster by donating priority.
-    if (priority > lock->donated_priority) {
+    // Walk up the chain of lock holders.  Each holder's effective priority
+    // is at least the priority donated to every lock it holds, so the walk
+    // can stop at the first lock or holder that already has PRIORITY.
+    while (lock != NULL && priority > lock->donated_priority) {
+        // Help free the lock faster by donating priority.
         lock->donated_priority = priority;
-    }
 
-    // Check to see if the holder of the lock we are waiting on is waiting for
-    // a nested lock and a "parent" thread has donated a higher priority than
-    // that nested thread.
-    struct thread *nested_t = lock->holder;
-    if (nested_t != NULL && nested_t->priority < priority) {
+        struct thread *nested_t = lock->holder;
+        if (nested_t == NULL || nested_t->eff_priority >= priority) {
+            break;
+        }
+        nested_t->eff_priority = priority;
 
-        // Move the lock holder into a new ready_queue, if it is not running.
+        // Move the lock holder into a new ready_queue, if it is not running,
+        // and to its new place in the queue it is waiting in, if blocked.  A
+        // thread in cond_wait() is queued on the condition before it blocks,
+        // so it is requeued there whatever its status.
         if (nested_t->status == THREAD_READY) {
             thread_reschedule(nested_t, priority);
         }
-
-        struct lock *nested_l = nested_t->lock_waiton;
-
-        if (nested_l != NULL) {
-            // Donate the "parent" thread's priority to the nested lock.
-            donate_priority(nested_l, priority);
+        if (nested_t->status == THREAD_BLOCKED ||
+            nested_t->cond_waiton != NULL) {
+            synch_requeue(nested_t, priority);
         }
+
+        // Donate the "parent" thread's priority to the nested lock that the
+        // holder is waiting on, if any.
+        lock = nested_t->lock_waiton;
     }
 }
 
@@ -263,8 +377,17 @@ bool lock_try_acquire(struct lock *lock) {
     ASSERT(!lock_held_by_current_thread(lock));
 
     success = sema_try_down(&lock->semaphore);
-    if (success)
+    if (success) {
+      enum intr_level old_level = intr_disable();
       lock->holder = thread_current();
+      lock->donated_priority = thread_get_priority();
+      list_push_back(&thread_current()->locks, &lock->elem);
+#ifdef LOCK_PROFILE
+      lock->profile.acquisitions++;
+      lock->profile.acquired_at = rdtsc();
+#endif
+      intr_set_level(old_level);
+    }
 
     return success;
 }
@@ -283,6 +406,10 @@ void lock_release(struct lock *lock) {
 
     lock->holder = NULL;
     list_remove(&lock->elem);
+    thread_update_priority(thread_current());
+#ifdef LOCK_PROFILE
+    lock->profile.hold_cycles += rdtsc() - lock->profile.acquired_at;
+#endif
 
     intr_set_level(old_level);
 
@@ -298,19 +425,35 @@ bool lock_held_by_current_thread(const struct lock *lock) {
     return lock->holder == thread_current();
 }
 
-/*! One semaphore in a list. */
+/*! Returns true if some thread holds LOCK, or has taken it and is about to
+    become its holder, false otherwise.  Interrupts must be off, and the
+    answer holds only until they are turned back on.  This lets code that
+    must not block, such as the idle thread, skip work that would race with
+    a lock holder, without taking the lock itself. */
+bool lock_is_held(const struct lock *lock) {
+    ASSERT(lock != NULL);
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    return lock->semaphore.value == 0;
+}
+
+/*! One semaphore in a condition variable's waiters. */
 struct semaphore_elem {
-    struct list_elem elem;              /*!< List element. */
+    struct rb_elem elem;                /*!< Tree element. */
     struct semaphore semaphore;         /*!< This semaphore. */
+    int priority;                       /*!< Priority of the waiting thread. */
+    struct thread *thread;              /*!< The waiting thread. */
 };
 
+static void cond_waiter_detach(struct semaphore_elem *);
+
 /*! Initializes condition variable COND.  A condition variable
     allows one piece of code to signal a condition and cooperating
     code to receive the signal and act upon it. */
 void cond_init(struct condition *cond) {
     ASSERT(cond != NULL);
 
-    list_init(&cond->waiters);
+    rb_init(&cond->waiters, sema_waiters_pri_higher, NULL);
 }
 
 /*! Atomically releases LOCK and waits for COND to be signaled by
@@ -335,6 +478,8 @@ void cond_init(struct condition *cond) {
     we need to sleep. */
 void cond_wait(struct condition *cond, struct lock *lock) {
     struct semaphore_elem waiter;
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
 
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
@@ -342,8 +487,26 @@ void cond_wait(struct condition *cond, struct lock *lock) {
     ASSERT(lock_held_by_current_thread(lock));
 
     sema_init(&waiter.semaphore, 0);
-    list_push_back(&cond->waiters, &waiter.elem);
+
+    // The waiters can also be requeued by a donation from another thread,
+    // so they are only touched with interrupts off.
+    old_level = intr_disable();
+    waiter.priority = thread_get_priority();
+    waiter.thread = cur;
+    rb_insert(&cond->waiters, &waiter.elem);
+    cur->cond_waiton = cond;
+    cur->cond_elem = &waiter.elem;
+    intr_set_level(old_level);
+
     lock_release(lock);
+
+    // Releasing LOCK may have taken away a priority donated through it, so
+    // key the waiter by the priority left after the release.  If we were
+    // already signaled, cond_waiton is null and this does nothing.
+    old_level = intr_disable();
+    synch_requeue(cur, thread_get_priority());
+    intr_set_level(old_level);
+
     sema_down(&waiter.semaphore);
     lock_acquire(lock);
 }
@@ -356,15 +519,25 @@ void cond_wait(struct condition *cond, struct lock *lock) {
     make sense to try to signal a condition variable within an
     interrupt handler. */
 void cond_signal(struct condition *cond, struct lock *lock UNUSED) {
+    struct semaphore_elem *waiter = NULL;
+    enum intr_level old_level;
+
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
     ASSERT(!intr_context ());
     ASSERT(lock_held_by_current_thread (lock));
 
-    if (!list_empty(&cond->waiters)) {
-        list_sort(&cond->waiters, sema_waiters_pri_higher, NULL);
-        sema_up(&list_entry(list_pop_front(&cond->waiters),
-                            struct semaphore_elem, elem)->semaphore);
+    old_level = intr_disable();
+    if (!rb_empty(&cond->waiters)) {
+        waiter = rb_entry(rb_min(&cond->waiters), struct semaphore_elem,
+                          elem);
+        rb_remove(&cond->waiters, &waiter->elem);
+        cond_waiter_detach(waiter);
+    }
+    intr_set_level(old_level);
+
+    if (waiter != NULL) {
+        sema_up(&waiter->semaphore);
     }
 }
 
@@ -374,37 +547,176 @@ void cond_signal(struct condition *cond, struct lock *lock UNUSED) {
     An interrupt handler cannot acquire a lock, so it does not
     make sense to try to signal a condition variable within an
     interrupt handler. */
-void cond_broadcast(struct condition *cond, struct lock *lock) {
+void cond_broadcast(struct condition *cond, struct lock *lock UNUSED) {
+    struct rb_elem *e, *next;
+    enum intr_level old_level;
+
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
+    ASSERT(!intr_context ());
+    ASSERT(lock_held_by_current_thread (lock));
 
-    while (!list_empty(&cond->waiters))
-        cond_signal(cond, lock);
+    // Take every waiter off COND at once and wake them in priority order
+    // with an in-order walk, instead of removing them one at a time.  The
+    // waiters cannot return from cond_wait() and free their semaphore_elem
+    // before we release LOCK.
+    old_level = intr_disable();
+    e = rb_min(&cond->waiters);
+    for (next = e; next != NULL; next = rb_next(next)) {
+        cond_waiter_detach(rb_entry(next, struct semaphore_elem, elem));
+    }
+    rb_init(&cond->waiters, sema_waiters_pri_higher, NULL);
+    intr_set_level(old_level);
+
+    for (; e != NULL; e = next) {
+        next = rb_next(e);
+        sema_up(&rb_entry(e, struct semaphore_elem, elem)->semaphore);
+    }
 }
 
-/*! A function that returns if threads A's priority is less than B's */
-bool waiting_pri_higher(const struct list_elem *a, const struct list_elem *b,
-        void *aux UNUSED) {
+/*! Marks the thread waiting on WAITER as no longer queued on a condition
+    variable.  Must be called with interrupts off. */
+static void cond_waiter_detach(struct semaphore_elem *waiter) {
+    waiter->thread->cond_waiton = NULL;
+    waiter->thread->cond_elem = NULL;
+}
 
-    struct thread *f = list_entry (a, struct thread, semaelem);
-    struct thread *g = list_entry (b, struct thread, semaelem);
+/*! Moves T, whose effective priority has changed to PRIORITY, to its new
+    place among the waiters of the semaphore and the condition variable it is
+    waiting on, if any.  T is blocked, or is between queuing itself in
+    cond_wait() and blocking there.  Must be called with interrupts off. */
+void synch_requeue(struct thread *t, int priority) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (t->sema_waiton != NULL && t->wait_priority != priority) {
+        rb_remove(&t->sema_waiton->waiters, &t->semaelem);
+        t->wait_priority = priority;
+        rb_insert(&t->sema_waiton->waiters, &t->semaelem);
+    }
 
-    return thread_get_priority_t(f) >= thread_get_priority_t(g);
+    if (t->cond_waiton != NULL) {
+        struct semaphore_elem *waiter =
+            rb_entry(t->cond_elem, struct semaphore_elem, elem);
+        if (waiter->priority != priority) {
+            rb_remove(&t->cond_waiton->waiters, &waiter->elem);
+            waiter->priority = priority;
+            rb_insert(&t->cond_waiton->waiters, &waiter->elem);
+        }
+    }
 }
 
-/*! A function that returns if one semaphore's waiter has a higher priority
-    than another's. */
-bool sema_waiters_pri_higher(const struct list_elem *a,
-        const struct list_elem *b, void *aux UNUSED) {
-    struct semaphore *s, *t;
-    s = &list_entry(a, struct semaphore_elem, elem)->semaphore;
-    t = &list_entry(b, struct semaphore_elem, elem)->semaphore;
+/*! Initializes RW as a readers-writer lock.  Any number of readers may hold
+    RW at once, or a single writer.
+
+    A writer holds RW's underlying lock for as long as it writes, and each
+    reader passes through that lock on the way in.  So:
+
+    - Readers and writers line up together in the lock's waiters, in order
+      of priority and then arrival, so a waiting writer holds back every
+      reader that arrives after it and cannot be starved, while a reader
+      waits only for the writers ahead of it.
+
+    - Threads waiting for a writer donate their priority to it like for any
+      other lock.  Readers cannot receive donations, since there may be
+      many of them.
+
+    Once a writer has the lock it waits for the readers already inside to
+    leave.  The last one to leave wakes it up. */
+void rwlock_init(struct rwlock *rw) {
+    ASSERT(rw != NULL);
+
+    lock_init(&rw->lock);
+    rw->readers = 0;
+    rw->writer_waiting = false;
+    sema_init(&rw->drained, 0);
+}
+
+/*! Acquires RW for reading, sleeping while a writer holds it or is waiting
+    ahead of us.  This function may sleep, so it must not be called within
+    an interrupt handler. */
+void rwlock_acquire_read(struct rwlock *rw) {
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+
+    lock_acquire(&rw->lock);
+    old_level = intr_disable();
+    rw->readers++;
+    intr_set_level(old_level);
+    lock_release(&rw->lock);
+}
+
+/*! Releases RW, which the current thread holds for reading. */
+void rwlock_release_read(struct rwlock *rw) {
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+
+    old_level = intr_disable();
+    ASSERT(rw->readers > 0);
+    if (--rw->readers == 0 && rw->writer_waiting) {
+        rw->writer_waiting = false;
+        sema_up(&rw->drained);
+    }
+    intr_set_level(old_level);
+}
+
+/*! Acquires RW for writing, sleeping until no other thread holds it.  This
+    function may sleep, so it must not be called within an interrupt
+    handler. */
+void rwlock_acquire_write(struct rwlock *rw) {
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+
+    lock_acquire(&rw->lock);
+
+    // No new readers can get in now, so wait for the current ones to leave.
+    old_level = intr_disable();
+    if (rw->readers > 0) {
+        rw->writer_waiting = true;
+        sema_down(&rw->drained);
+    }
+    intr_set_level(old_level);
+}
+
+/*! Releases RW, which the current thread holds for writing. */
+void rwlock_release_write(struct rwlock *rw) {
+    ASSERT(rw != NULL);
+    ASSERT(rw->readers == 0);
+
+    lock_release(&rw->lock);
+}
+
+/*! Returns true if the current thread holds RW for writing, false
+    otherwise. */
+bool rwlock_held_for_write(const struct rwlock *rw) {
+    ASSERT(rw != NULL);
+
+    return lock_held_by_current_thread(&rw->lock);
+}
+
+/*! Orders a semaphore's waiters: returns true if thread A was queued at a
+    higher priority than thread B.  Threads queued at the same priority are
+    woken in FIFO order. */
+bool waiting_pri_higher(const struct rb_elem *a, const struct rb_elem *b,
+        void *aux UNUSED) {
+
+    struct thread *f = rb_entry (a, struct thread, semaelem);
+    struct thread *g = rb_entry (b, struct thread, semaelem);
+
+    return f->wait_priority > g->wait_priority;
+}
 
-    ASSERT(list_size(&s->waiters) == 1);
-    ASSERT(list_size(&t->waiters) == 1);
+/*! Orders a condition variable's waiters: returns true if one semaphore's
+    waiter was queued at a higher priority than another's. */
+bool sema_waiters_pri_higher(const struct rb_elem *a,
+        const struct rb_elem *b, void *aux UNUSED) {
+    struct semaphore_elem *s, *t;
+    s = rb_entry(a, struct semaphore_elem, elem);
+    t = rb_entry(b, struct semaphore_elem, elem);
 
-    return waiting_pri_higher(list_front(&s->waiters), list_front(&t->waiters),
-                              NULL);
+    return s->priority > t->priority;
 }
 
 /*! A function that returns true if lock a has a lower donated priority than
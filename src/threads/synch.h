@@ -8,12 +8,34 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <rbtree.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+#ifdef LOCK_PROFILE
+/*! Contention statistics for a named lock.  Kept only in kernels built
+    with LOCK_PROFILE defined; times are in CPU cycles. */
+struct lock_profile {
+    char name[16];              /*!< Name given to lock_init_named(). */
+    struct list_elem elem;      /*!< Element in the list of named locks. */
+    uint64_t acquisitions;      /*!< Times the lock was acquired. */
+    uint64_t contended;         /*!< Acquisitions that had to wait. */
+    uint64_t wait_cycles;       /*!< Total time spent waiting. */
+    uint64_t max_wait_cycles;   /*!< Longest wait. */
+    uint64_t hold_cycles;       /*!< Total time the lock was held. */
+    uint64_t acquired_at;       /*!< When the current holder got the lock. */
+};
+#endif
 
 /*! A counting semaphore. */
 struct semaphore {
     unsigned value;             /*!< Current value. */
-    struct list waiters;        /*!< List of waiting threads. */
+    struct rb_tree waiters;     /*!< Waiting threads, highest priority first. */
+#ifdef LOCK_PROFILE
+    struct lock_profile *profile; /*!< Statistics for sema_down(), or null. */
+#endif
 };
 
 void sema_init(struct semaphore *, unsigned value);
@@ -29,18 +51,25 @@ struct lock {
 
     struct list_elem elem;      /*!< The list elem for a thread's list of locks. */
     int donated_priority;       /*!< The highest priority donated by a thread. */
+#ifdef LOCK_PROFILE
+    struct lock_profile profile; /*!< Contention statistics. */
+#endif
 };
 
 void lock_init(struct lock *);
+void lock_init_named(struct lock *, const char *name);
+void lock_print_stats(void);
 void lock_acquire(struct lock *);
 void donate_priority(struct lock *, int priority);
 bool lock_try_acquire(struct lock *);
 void lock_release(struct lock *);
 bool lock_held_by_current_thread(const struct lock *);
+bool lock_is_held(const struct lock *);
 
 /*! Condition variable. */
 struct condition {
-    struct list waiters; /*!< List of semaphores holding waiting threads. */
+    struct rb_tree waiters; /*!< Semaphores holding waiting threads, highest
+                                 priority first. */
 };
 
 void cond_init(struct condition *);
@@ -48,14 +77,32 @@ void cond_wait(struct condition *, struct lock *);
 void cond_signal(struct condition *, struct lock *);
 void cond_broadcast(struct condition *, struct lock *);
 
+/*! Readers-writer lock. */
+struct rwlock {
+    struct lock lock;           /*!< Held by the writer, and briefly by each
+                                     reader on its way in. */
+    unsigned readers;           /*!< Number of readers holding the rwlock. */
+    bool writer_waiting;        /*!< Writer waiting for readers to leave? */
+    struct semaphore drained;   /*!< Upped when the last reader leaves. */
+};
+
+void rwlock_init(struct rwlock *);
+void rwlock_acquire_read(struct rwlock *);
+void rwlock_release_read(struct rwlock *);
+void rwlock_acquire_write(struct rwlock *);
+void rwlock_release_write(struct rwlock *);
+bool rwlock_held_for_write(const struct rwlock *);
+
+void synch_requeue(struct thread *, int priority);
+
 /* A function that returns if threads A's priority is greater than B's */
-bool waiting_pri_higher(const struct list_elem *a, const struct list_elem *b,
+bool waiting_pri_higher(const struct rb_elem *a, const struct rb_elem *b,
         void *aux);
 
 /* A function that returns the semaphore with the highest priority waiting
    thread. */
-bool sema_waiters_pri_higher(const struct list_elem *a,
-        const struct list_elem *b, void *aux);
+bool sema_waiters_pri_higher(const struct rb_elem *a,
+        const struct rb_elem *b, void *aux);
 
 /* A function that returns the lock with the lower donated priority. */
 bool lock_donated_pri_lower(const struct list_elem *a,
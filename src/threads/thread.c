@@ -4,13 +4,17 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "threads/work.h"
 #include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -21,14 +25,80 @@
     of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/*! List processes in THREAD_BLOCKED state, that is, processes
-    that are blocked because they have been made to sleep. */
-static struct list wait_list;
+/*! Timer wheel of processes in THREAD_BLOCKED state because they have been
+    made to sleep (see thread_sleep()).
+
+    Sleepers are hashed by wake-up tick into a hierarchy of wheels.  Level 0
+    has one slot per tick for the next WHEEL_L0_SIZE ticks.  Each upper level
+    has WHEEL_LN_SIZE slots, each covering one full turn of the level below.
+    Whenever level 0 wraps around, the next slot of level 1 is cascaded down
+    into it, and so on upwards.  Inserting a sleeper is O(1), and each sleeper
+    is moved at most once per level before it expires.  Sleeps longer than the
+    whole wheel are parked in the top level and re-filed each time they are
+    cascaded.
+    @{ */
+#define WHEEL_L0_BITS 8
+#define WHEEL_LN_BITS 6
+#define WHEEL_LEVELS 4
+#define WHEEL_L0_SIZE (1 << WHEEL_L0_BITS)
+#define WHEEL_LN_SIZE (1 << WHEEL_LN_BITS)
+#define WHEEL_SHIFT(LEVEL) (WHEEL_L0_BITS + ((LEVEL) - 1) * WHEEL_LN_BITS)
+#define WHEEL_SPAN_BITS WHEEL_SHIFT(WHEEL_LEVELS)
+
+static struct list wheel_l0[WHEEL_L0_SIZE];
+static struct list wheel_ln[WHEEL_LEVELS - 1][WHEEL_LN_SIZE];
+static int64_t wheel_clock;     /*!< Last tick processed by threads_wake(). */
+static unsigned wheel_cnt;      /*!< Number of threads in the wheel. */
+/*! @} */
 
 /*! List of processes in THREAD_READY state, that is, processes
     that are ready to run but not actually running. */
 static struct list ready_lists[PRI_MAX - PRI_MIN + 1];
 
+/*! Number of 32-bit words in ready_mask. */
+#define READY_MASK_WORDS ((PRI_MAX - PRI_MIN + 1 + 31) / 32)
+
+/*! Summary of which ready_lists are non-empty.  Bit (I % 32) of
+    ready_mask[I / 32] is set iff ready_lists[I] holds a thread, so the
+    highest runnable priority can be found with a bit scan instead of
+    walking every list. */
+static uint32_t ready_mask[READY_MASK_WORDS];
+
+/*! Completely fair scheduler run queue (see thread_cfs).
+
+    Ready threads are kept in a red-black tree ordered by vruntime, the CPU
+    time they have received scaled by the inverse of their weight, and the
+    leftmost thread always runs next.  A thread's weight comes from its nice
+    value; each nice step is worth about 10% of CPU time relative to the
+    next, as in Linux.  Instead of a fixed TIME_SLICE, the running thread gets
+    its weighted share of CFS_LATENCY ticks, but no less than
+    CFS_MIN_GRANULARITY.
+    @{ */
+#define CFS_NICE_0_WEIGHT 1024      /*!< Weight of a thread with nice 0. */
+#define CFS_TICK 1024               /*!< vruntime of one tick at nice 0. */
+#define CFS_LATENCY 6               /*!< Target scheduling latency, in ticks. */
+#define CFS_MIN_GRANULARITY 1       /*!< Shortest slice, in ticks. */
+#define CFS_WAKEUP_GRANULARITY CFS_TICK /*!< vruntime lead a woken thread
+                                             needs to preempt. */
+
+static struct rb_tree cfs_tree;
+static uint64_t cfs_min_vruntime;   /*!< Monotonic floor of all vruntimes. */
+static unsigned long cfs_load;      /*!< Total weight of threads in cfs_tree. */
+
+/*! Weight for each nice value from NICE_MIN to NICE_MAX. */
+static const unsigned long cfs_weights[NICE_MAX - NICE_MIN + 1] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */  9548,  7620,  6100,  4904,  3906,
+    /*  -5 */  3121,  2501,  1991,  1586,  1277,
+    /*   0 */  1024,   820,   655,   526,   423,
+    /*   5 */   335,   272,   215,   172,   137,
+    /*  10 */   110,    87,    70,    56,    45,
+    /*  15 */    36,    29,    23,    18,    15,
+    /*  20 */    12,
+};
+/*! @} */
+
 /*! List of all processes.  Processes are added to this list
     when they are first scheduled and removed when they exit. */
 static struct list all_list;
@@ -45,6 +115,38 @@ static struct lock tid_lock;
 /*! Lock used for ready_lists */
 static struct lock ready_lock;
 
+/*! Once a second, the MLFQS decays every thread's recent_cpu by the
+    coefficient 2*load_avg / (2*load_avg + 1).  Rather than visiting every
+    thread from the timer interrupt, the coefficients of the last DECAY_HIST
+    seconds are kept here and applied to a thread the next time it is looked
+    at: every second for the running thread, when it is unblocked for a
+    blocked thread, and in a pass over the ready lists that the timer's
+    deferred work makes right after each decay, with interrupts on, for
+    ready threads.  A thread blocked for longer than DECAY_HIST seconds only
+    gets the most recent DECAY_HIST decays.
+    @{ */
+#define DECAY_HIST 128
+static fp decay_hist[DECAY_HIST];   /*!< Coefficient of decay I, at I % DECAY_HIST. */
+static unsigned decay_epoch;        /*!< Number of decays so far. */
+/*! @} */
+
+/*! Cache of pages freed by exiting threads, reused by thread_create() to
+    avoid a round trip through the page allocator.  Only the struct thread
+    header of a reused page is reinitialized.  Freed pages start out dirty;
+    the idle thread zeroes them in the background so that an exited thread's
+    stack contents do not linger, and thread_create() prefers those clean
+    pages.  Both stacks are accessed with interrupts off.
+    @{ */
+#define THREAD_CACHE_SIZE 16
+static void *cache_clean[THREAD_CACHE_SIZE];    /*!< Zeroed pages. */
+static int cache_clean_cnt;
+static void *cache_dirty[THREAD_CACHE_SIZE];    /*!< Pages not yet zeroed. */
+static int cache_dirty_cnt;
+static int cache_scrub_cnt;     /*!< Pages out of the cache being zeroed. */
+static long long cache_hits;    /*!< thread_create() calls served by cache. */
+static long long cache_misses;  /*!< thread_create() calls that used palloc. */
+/*! @} */
+
 /*! Stack frame for kernel_thread(). */
 struct kernel_thread_frame {
     void *eip;                  /*!< Return address. */
@@ -57,6 +159,14 @@ static long long idle_ticks;    /*!< # of timer ticks spent idle. */
 static long long kernel_ticks;  /*!< # of timer ticks in kernel threads. */
 static long long user_ticks;    /*!< # of timer ticks in user programs. */
 
+/*! log2 histogram of how long threads wait in the run queue before they run,
+    in cycles.  See SCHED_HIST_BUCKETS for the bucket boundaries. */
+static unsigned rq_delay_hist[SCHED_HIST_BUCKETS];
+
+/*! Time schedule() spends in next_thread_to_run().  Updated with interrupts
+    off. */
+static struct thread_pick_stats pick_stats;
+
 /* Scheduling. */
 #define TIME_SLICE 4            /*!< # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /*!< # of timer ticks since last yield. */
@@ -69,17 +179,43 @@ static unsigned num_threads_ready;
     Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/*! If true, use the completely fair scheduler instead.
+    Controlled by kernel command-line option "-sched=cfs". */
+bool thread_cfs;
+
 static void kernel_thread(thread_func *, void *aux);
 
 static void idle(void *aux UNUSED);
 static struct thread *running_thread(void);
 static struct thread *next_thread_to_run(void);
+static void wheel_init(void);
+static void wheel_insert(struct thread *);
+static void wheel_cascade(int level, int64_t now);
+static void ready_list_push(struct thread *, int priority);
+static void ready_list_remove(struct thread *);
+static int ready_max_priority(void);
+static void ready_lists_refresh(void);
+static void thread_catch_up_decay(struct thread *);
+static int mlfqs_priority(struct thread *);
+static unsigned long cfs_weight(const struct thread *);
+static bool cfs_less(const struct rb_elem *, const struct rb_elem *,
+                     void *aux);
+static void cfs_enqueue(struct thread *);
+static struct thread *cfs_dequeue_min(void);
+static void cfs_place(struct thread *);
+static void cfs_tick(struct thread *);
+static unsigned cfs_slice(struct thread *);
 static void init_thread(struct thread *, const char *name, int priority);
 static bool is_thread(struct thread *) UNUSED;
 static void *alloc_frame(struct thread *, size_t size);
 static void schedule(void);
+static void sched_stats_switch(struct thread *cur, struct thread *next);
+static int rq_delay_bucket(uint64_t delay);
 void thread_schedule_tail(struct thread *prev);
 static tid_t allocate_tid(void);
+static struct thread *thread_page_get(void);
+static void thread_page_put(struct thread *);
+static bool thread_page_scrub(void);
 
 /*! Initializes the threading system by transforming the code
     that's currently running into a thread.  This can't work in
@@ -95,15 +231,22 @@ static tid_t allocate_tid(void);
 void thread_init(void) {
     ASSERT(intr_get_level() == INTR_OFF);
 
-    lock_init(&tid_lock);
-    lock_init(&ready_lock);
+    lock_init_named(&tid_lock, "tid");
+    lock_init_named(&ready_lock, "ready");
     /* Initialize the array of ready_lists */
     int i = PRI_MIN;
     for (; i <= PRI_MAX; i++) {
         list_init(&ready_lists[i]);
     }
+    for (i = 0; i < READY_MASK_WORDS; i++) {
+        ready_mask[i] = 0;
+    }
 
-    list_init(&wait_list);
+    rb_init(&cfs_tree, cfs_less, NULL);
+    cfs_min_vruntime = 0;
+    cfs_load = 0;
+
+    wheel_init();
     list_init(&all_list);
 
     num_threads_ready = 0;
@@ -113,6 +256,7 @@ void thread_init(void) {
     init_thread(initial_thread, "main", PRI_DEFAULT);
     initial_thread->status = THREAD_RUNNING;
     initial_thread->tid = allocate_tid();
+    initial_thread->sched_stamp = rdtsc();
 
     if (thread_mlfqs) {
         // Initializing the load_avg
@@ -165,14 +309,107 @@ void thread_tick(void) {
     }
 
     /* Enforce preemption. */
-    if (++thread_ticks >= TIME_SLICE)
+    if (thread_cfs) {
+        cfs_tick(t);
+        if (++thread_ticks >= cfs_slice(t))
+            intr_yield_on_return();
+    }
+    else if (++thread_ticks >= TIME_SLICE)
         intr_yield_on_return();
 }
 
-/*! Prints thread statistics. */
+/*! Prints thread statistics: the global tick counts, the scheduling
+    statistics of each thread that is still alive, and the run queue delay
+    histogram. */
 void thread_print_stats(void) {
+    struct list_elem *e;
+    int i, last;
+
     printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
            idle_ticks, kernel_ticks, user_ticks);
+    printf("Thread: %lld page cache hits, %lld misses\n",
+           cache_hits, cache_misses);
+
+    for (e = list_begin(&all_list); e != list_end(&all_list);
+         e = list_next(e)) {
+        struct thread *t = list_entry(e, struct thread, allelem);
+        struct sched_stats *s = &t->stats;
+
+        printf("Thread %s (tid %d): %lld ns running, %lld waiting, "
+               "%u voluntary and %u involuntary switches, %u wakeups, "
+               "%lld ns max wakeup latency\n",
+               t->name, t->tid, clock_cycles_to_ns(s->run_cycles),
+               clock_cycles_to_ns(s->wait_cycles),
+               s->voluntary_switches, s->involuntary_switches, s->wakeups,
+               clock_cycles_to_ns(s->max_wakeup_cycles));
+    }
+
+    for (last = SCHED_HIST_BUCKETS - 1; last > 0; last--) {
+        if (rq_delay_hist[last] != 0) {
+            break;
+        }
+    }
+    printf("Run queue delay (ns):\n");
+    for (i = 0; i <= last; i++) {
+        if (i == 0) {
+            printf("  %20s: %u\n", "0", rq_delay_hist[i]);
+        }
+        else {
+            printf("  %20lld: %u\n", clock_cycles_to_ns(1ULL << (i - 1)),
+                   rq_delay_hist[i]);
+        }
+    }
+}
+
+/*! Copies the scheduling statistics of the thread with the given TID into
+    *STATS, and, if HIST is not null, the run queue delay histogram into
+    HIST.  Returns false if there is no such thread. */
+bool thread_get_sched_stats(tid_t tid, struct sched_stats *stats,
+                            unsigned hist[SCHED_HIST_BUCKETS]) {
+    struct list_elem *e;
+    bool found = false;
+    enum intr_level old_level = intr_disable();
+
+    for (e = list_begin(&all_list); e != list_end(&all_list);
+         e = list_next(e)) {
+        struct thread *t = list_entry(e, struct thread, allelem);
+        if (t->tid == tid) {
+            *stats = t->stats;
+            /* Include the current stretch of running or waiting. */
+            if (t->status == THREAD_RUNNING) {
+                stats->run_cycles += rdtsc() - t->sched_stamp;
+            }
+            else if (t->status == THREAD_READY) {
+                stats->wait_cycles += rdtsc() - t->sched_stamp;
+            }
+            found = true;
+            break;
+        }
+    }
+    if (found && hist != NULL) {
+        memcpy(hist, rq_delay_hist, sizeof rq_delay_hist);
+    }
+
+    intr_set_level(old_level);
+    return found;
+}
+
+/*! Copies the statistics on how long schedule() takes to choose the next
+    thread into *STATS. */
+void thread_get_pick_stats(struct thread_pick_stats *stats) {
+    enum intr_level old_level = intr_disable();
+    *stats = pick_stats;
+    intr_set_level(old_level);
+}
+
+/*! Clears the statistics on how long schedule() takes to choose the next
+    thread. */
+void thread_reset_pick_stats(void) {
+    enum intr_level old_level = intr_disable();
+    pick_stats.count = 0;
+    pick_stats.cycles = 0;
+    pick_stats.max_cycles = 0;
+    intr_set_level(old_level);
 }
 
 /*! Creates a new kernel thread named NAME with the given initial PRIORITY,
@@ -200,7 +437,7 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
     ASSERT(function != NULL);
 
     /* Allocate thread. */
-    t = palloc_get_page(PAL_ZERO);
+    t = thread_page_get();
     if (t == NULL)
         return TID_ERROR;
 
@@ -212,9 +449,16 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
     if (thread_mlfqs) {
         t->nice = thread_current()->nice;
         t->recent_cpu = thread_current()->recent_cpu;
+        t->recent_cpu_epoch = thread_current()->recent_cpu_epoch;
         thread_calculate_priority(t);
     }
 
+    /* New threads start level with the least-served runnable thread. */
+    if (thread_cfs) {
+        t->nice = thread_current()->nice;
+        t->vruntime = cfs_min_vruntime;
+    }
+
     /* Stack frame for kernel_thread(). */
     kf = alloc_frame(t, sizeof *kf);
     kf->eip = NULL;
@@ -243,8 +487,10 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
     better idea to use one of the synchronization primitives in synch.h. */
 void thread_block(void) {
     ASSERT(!intr_context());
+    ASSERT(!work_context());
     ASSERT(intr_get_level() == INTR_OFF);
 
+    trace(TRACE_BLOCK, 0, 0);
     thread_current()->status = THREAD_BLOCKED;
     schedule();
 }
@@ -264,16 +510,45 @@ void thread_unblock(struct thread *t) {
     old_level = intr_disable();
 
     ASSERT(t->status == THREAD_BLOCKED);
-    list_push_back(&ready_lists[thread_get_priority_t(t)], &t->rdyelem);
+    trace(TRACE_UNBLOCK, t->tid, 0);
+    t->sched_stamp = rdtsc();
+    t->sched_woken = true;
+    if (thread_cfs) {
+        cfs_place(t);
+        cfs_enqueue(t);
+        num_threads_ready++;
+        t->status = THREAD_READY;
+
+        /* Preempt the running thread if the woken thread is sufficiently
+           behind it in vruntime. */
+        struct thread *cur = thread_current();
+        if (cur == idle_thread ||
+            t->vruntime + CFS_WAKEUP_GRANULARITY < cur->vruntime) {
+            if (intr_context() || work_context()) {
+                intr_yield_on_return();
+            }
+            else if (cur != idle_thread) {
+                thread_yield();
+            }
+        }
+
+        intr_set_level(old_level);
+        return;
+    }
+    if (thread_mlfqs) {
+        thread_catch_up_decay(t);
+        t->priority = mlfqs_priority(t);
+    }
+    ready_list_push(t, thread_get_priority_t(t));
     num_threads_ready++;
     t->status = THREAD_READY;
 
     /* If the current running thread is of lower priority than a new thread
        that is about to be unblocked, then yield the current thread */
-    if (thread_get_priority() < t->priority) {
+    if (thread_get_priority() < thread_get_priority_t(t)) {
 
-        // We don't want an interrupt handler to yield.
-        if (!intr_context()) {
+        // We don't want an interrupt handler or deferred work to yield.
+        if (!intr_context() && !work_context()) {
             thread_yield();
         }
     }
@@ -316,6 +591,7 @@ void thread_exit(void) {
 #ifdef USERPROG
     process_exit();
 #endif
+    malloc_thread_exit();
 
     /* Remove thread from all threads list, set our status to dying,
        and schedule another process.  That process will destroy us
@@ -334,11 +610,17 @@ void thread_yield(void) {
     enum intr_level old_level;
 
     ASSERT(!intr_context());
+    ASSERT(!work_context());
 
     old_level = intr_disable();
 
     if (cur != idle_thread) {
-        list_push_back(&ready_lists[thread_get_priority()], &cur->rdyelem);
+        if (thread_cfs) {
+            cfs_enqueue(cur);
+        }
+        else {
+            ready_list_push(cur, thread_get_priority());
+        }
         num_threads_ready++;
     }
     cur->status = THREAD_READY;
@@ -348,7 +630,7 @@ void thread_yield(void) {
 }
 
 
-/*! Helper function for thread_sleep, return whether thread f should
+/*! Helper function for threads_wake, return whether thread f should
     wake up before thread g so the list is in order,
     with the head having the earliest wake time. */
 static bool awake_earlier (const struct list_elem *a, const struct list_elem *b,
@@ -365,31 +647,141 @@ static bool awake_earlier (const struct list_elem *a, const struct list_elem *b,
     }
 }
 
+/*! Blocks thread T, which must be the running thread, until the tick stored
+    in its ticks_awake member. */
 void thread_sleep(struct thread *t){
     ASSERT(intr_get_level() == INTR_ON);
 
     enum intr_level old_level = intr_disable();
-    list_insert_ordered(&wait_list, &(t->waitelem), awake_earlier, NULL);
+    // The slot for the current tick has already been processed, so a wake-up
+    // time that is not in the future means the next tick.
+    if (t->ticks_awake <= wheel_clock) {
+        t->ticks_awake = wheel_clock + 1;
+    }
+    wheel_insert(t);
+    wheel_cnt++;
     intr_set_level(old_level);
 
     sema_down(&t->sema_wait);
 }
 
+/*! Advances the sleep wheel up to TICKS_NOW, waking every thread whose
+    wake-up time has been reached.  Threads due on the same tick are woken in
+    awake_earlier() order.  Called from the timer's deferred work, with
+    interrupts off. */
 void threads_wake(int64_t ticks_now){
-    // The wait list has the thread with the earliest
-    // wake time in front, so go over the list until we find a thread
-    // with a later wake up time than the current time,
-    while (!list_empty(&wait_list)){
-        struct list_elem *welem_thr = list_front(&wait_list);
-        struct thread *thr = list_entry (welem_thr, struct thread, waitelem);
-
-        if (thr->ticks_awake <= ticks_now) {
-            sema_up(&thr->sema_wait);      // wake this thread
-            list_pop_front(&wait_list);    // remove it from the list
-        }
-        else {
+    while (wheel_clock < ticks_now) {
+        // Nothing is sleeping, so there is nothing to step through.
+        if (wheel_cnt == 0) {
+            wheel_clock = ticks_now;
             break;
         }
+
+        wheel_clock++;
+
+        // Whenever the levels below LEVEL have all wrapped around, LEVEL's
+        // next slot is due and gets cascaded down.
+        int level = 1;
+        while (level < WHEEL_LEVELS &&
+               (wheel_clock & (((int64_t) 1 << WHEEL_SHIFT(level)) - 1)) == 0) {
+            level++;
+        }
+        while (--level > 0) {
+            wheel_cascade(level, wheel_clock);
+        }
+
+        struct list *slot = &wheel_l0[wheel_clock & (WHEEL_L0_SIZE - 1)];
+        if (list_empty(slot)) {
+            continue;
+        }
+
+        list_sort(slot, awake_earlier, NULL);
+        while (!list_empty(slot)) {
+            struct thread *thr =
+                list_entry(list_pop_front(slot), struct thread, waitelem);
+            wheel_cnt--;
+            sema_up(&thr->sema_wait);
+        }
+    }
+}
+
+/*! Returns the earliest tick after the last one processed by threads_wake()
+    on which it will have work to do, that is, sleepers to wake or an upper
+    wheel slot to cascade.  Only ticks before LIMIT are examined; if none of
+    them has work, returns LIMIT.  Must be called with interrupts off. */
+int64_t threads_next_wake(int64_t limit) {
+    int64_t t;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (wheel_cnt == 0) {
+        return limit;
+    }
+
+    for (t = wheel_clock + 1; t < limit; t++) {
+        if ((t & (WHEEL_L0_SIZE - 1)) == 0 ||
+            !list_empty(&wheel_l0[t & (WHEEL_L0_SIZE - 1)])) {
+            return t;
+        }
+    }
+
+    return limit;
+}
+
+/*! Initializes the sleep wheel to empty. */
+static void wheel_init(void) {
+    int i, j;
+
+    for (i = 0; i < WHEEL_L0_SIZE; i++) {
+        list_init(&wheel_l0[i]);
+    }
+    for (i = 0; i < WHEEL_LEVELS - 1; i++) {
+        for (j = 0; j < WHEEL_LN_SIZE; j++) {
+            list_init(&wheel_ln[i][j]);
+        }
+    }
+    wheel_clock = 0;
+    wheel_cnt = 0;
+}
+
+/*! Files sleeping thread T into the wheel slot for its ticks_awake, which
+    must not be before wheel_clock.  Must be called with interrupts off. */
+static void wheel_insert(struct thread *t) {
+    int64_t expires = t->ticks_awake;
+    int64_t delta = expires - wheel_clock;
+    struct list *slot;
+
+    ASSERT(delta >= 0);
+
+    if (delta < WHEEL_L0_SIZE) {
+        slot = &wheel_l0[expires & (WHEEL_L0_SIZE - 1)];
+    }
+    else {
+        int level = 1;
+        while (level < WHEEL_LEVELS - 1 &&
+               delta >= (int64_t) 1 << WHEEL_SHIFT(level + 1)) {
+            level++;
+        }
+        if (delta >= (int64_t) 1 << WHEEL_SPAN_BITS) {
+            expires = wheel_clock + ((int64_t) 1 << WHEEL_SPAN_BITS) - 1;
+        }
+
+        slot = &wheel_ln[level - 1]
+                        [(expires >> WHEEL_SHIFT(level)) & (WHEEL_LN_SIZE - 1)];
+    }
+
+    list_push_back(slot, &t->waitelem);
+}
+
+/*! Re-files every thread in the current slot of wheel LEVEL (1 or higher),
+    which is due within the next turn of the level below, as of tick NOW. */
+static void wheel_cascade(int level, int64_t now) {
+    struct list *slot =
+        &wheel_ln[level - 1][(now >> WHEEL_SHIFT(level)) & (WHEEL_LN_SIZE - 1)];
+
+    while (!list_empty(slot)) {
+        wheel_insert(list_entry(list_pop_front(slot), struct thread,
+                                waitelem));
     }
 }
 
@@ -417,48 +809,60 @@ void thread_set_priority(int new_priority) {
     ASSERT(new_priority <= PRI_MAX);
     ASSERT(new_priority >= PRI_MIN);
 
+    enum intr_level old_level = intr_disable();
     thread_current()->priority = new_priority;
+    thread_update_priority(thread_current());
+    intr_set_level(old_level);
 
-    lock_acquire(&ready_lock);
-    /* Check if there are any threads in a higher queue that want to run */
-    int i = PRI_MAX;
-    for (; i > new_priority; i--) {
-        if (!list_empty(&ready_lists[i])) {
-            lock_release(&ready_lock);
-            thread_yield();
-            break;
-        }
-    }
-    if (lock_held_by_current_thread(&ready_lock)) {
-        lock_release(&ready_lock);
+    /* The fair scheduler ignores priorities. */
+    if (thread_cfs) {
+        return;
     }
 
+    /* Check if there are any threads in a higher queue that want to run */
+    lock_acquire(&ready_lock);
+    bool must_yield = ready_max_priority() > thread_get_priority();
+    lock_release(&ready_lock);
+
+    if (must_yield) {
+        thread_yield();
+    }
 }
 
 /*! Returns the current thread's priority. */
 int thread_get_priority(void) {
+    return thread_get_priority_t(thread_current());
+}
+
+/*! Returns T's effective priority, including any priority donated to it. */
+int thread_get_priority_t(struct thread *t) {
     if (thread_mlfqs) {
-        return thread_current()->priority;
+        return t->priority;
     }
 
-    return thread_get_priority_t(thread_current());
+    return t->eff_priority;
 }
 
-int thread_get_priority_t(struct thread *t) {
+/*! Recomputes T's effective priority after its base priority changed or it
+    released a lock.  The effective priority is the highest of its base
+    priority and the priority donated to any lock it holds.  Donations only
+    raise priorities, so donate_priority() updates eff_priority directly
+    instead of calling this.  Must be called with interrupts off. */
+void thread_update_priority(struct thread *t) {
     int priority = t->priority;
 
-    // If the thread is holding any locks, its priority is the highest of any
-    // donated priority from a thread waiting on one of those locks.
+    ASSERT(intr_get_level() == INTR_OFF);
+
     if (!list_empty(&t->locks)) {
         struct lock *max_pri_l = list_entry(
                 list_max(&t->locks, lock_donated_pri_lower, NULL),
                 struct lock, elem);
 
         if (max_pri_l->donated_priority > priority)
-            return max_pri_l->donated_priority;
+            priority = max_pri_l->donated_priority;
     }
 
-    return priority;
+    t->eff_priority = priority;
 }
 
 /*! Move a ready thread from its old ready queue to a new one depending on its
@@ -467,10 +871,8 @@ void thread_reschedule(struct thread *t, int priority) {
     if (!intr_context()) {
         lock_acquire(&ready_lock);
     }
-    struct list_elem *rdyelem = &t->rdyelem;
-    list_remove(rdyelem);
-    struct list *ready_list = &ready_lists[priority];
-    list_push_back(ready_list, rdyelem);
+    ready_list_remove(t);
+    ready_list_push(t, priority);
     if (!intr_context()) {
         lock_release(&ready_lock);
     }
@@ -485,22 +887,22 @@ void thread_set_nice(int nice) {
     }
 
     thread_current()->nice = nice;
+
+    /* The new weight takes effect at the running thread's next tick. */
+    if (thread_cfs) {
+        return;
+    }
+
     thread_calculate_priority(thread_current());
 
     /* Check if there are any threads in a higher queue that want to run */
-    int i = PRI_MAX;
     lock_acquire(&ready_lock);
-    for (; i > thread_get_priority(); i--) {
-        if (!list_empty(&ready_lists[i])) {
-            lock_release(&ready_lock);
-            thread_yield();
-            break;
-        }
-    }
-    if (lock_held_by_current_thread(&ready_lock)) {
-        lock_release(&ready_lock);
-    }
+    bool must_yield = ready_max_priority() > thread_get_priority();
+    lock_release(&ready_lock);
 
+    if (must_yield) {
+        thread_yield();
+    }
 }
 
 /*! Returns the current thread's nice value. */
@@ -522,25 +924,112 @@ int thread_get_recent_cpu(void) {
 
 /* Calculates a threads priority */
 void thread_calculate_priority(struct thread *t) {
-    int new_priority = PRI_MAX;
+    int new_priority = mlfqs_priority(t);
+
+    // If the priority changed and the thread was in the ready lists, move it.
+    if (new_priority != t->priority && t->status == THREAD_READY) {
+        thread_reschedule(t, new_priority);
+    }
+
+    t->priority = new_priority;
+}
 
-    new_priority = new_priority - fp_to_int(int_divide(t->recent_cpu, 4), 0);
-    new_priority = new_priority - (t->nice * 2);
+/*! Returns the MLFQS priority of T for its current recent_cpu and nice. */
+static int mlfqs_priority(struct thread *t) {
+    int priority = PRI_MAX;
 
-    if (new_priority < PRI_MIN) {
-        new_priority = PRI_MIN;
+    priority = priority - fp_to_int(int_divide(t->recent_cpu, 4), 0);
+    priority = priority - (t->nice * 2);
+
+    if (priority < PRI_MIN) {
+        priority = PRI_MIN;
     }
 
-    if (new_priority > PRI_MAX) {
-        new_priority = PRI_MAX;
+    if (priority > PRI_MAX) {
+        priority = PRI_MAX;
     }
 
-    // If the priority changed and the thread was in the ready lists, move it.
-    if (new_priority != t->priority && t->status == THREAD_READY) {
-        thread_reschedule(t, new_priority);
+    return priority;
+}
+
+/*! Records COEF as this second's recent_cpu decay coefficient, applies it
+    to the running thread and then to the ready threads.  Blocked threads
+    catch up when they are unblocked.  Called from the timer's deferred work
+    once per second, with interrupts on. */
+void thread_mlfqs_decay(fp coef) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(work_context());
+
+    old_level = intr_disable();
+    decay_epoch++;
+    decay_hist[decay_epoch % DECAY_HIST] = coef;
+
+    if (cur != idle_thread) {
+        thread_catch_up_decay(cur);
     }
+    intr_set_level(old_level);
 
-    t->priority = new_priority;
+    ready_lists_refresh();
+}
+
+/*! Applies to T's recent_cpu the decays it has missed since it was last
+    brought up to date. */
+static void thread_catch_up_decay(struct thread *t) {
+    unsigned behind = decay_epoch - t->recent_cpu_epoch;
+
+    if (behind > DECAY_HIST) {
+        behind = DECAY_HIST;
+    }
+
+    for (; behind > 0; behind--) {
+        fp coef = decay_hist[(decay_epoch - behind + 1) % DECAY_HIST];
+        t->recent_cpu = fp_multiply(coef, t->recent_cpu);
+        t->recent_cpu = int_add(t->recent_cpu, t->nice);
+    }
+    t->recent_cpu_epoch = decay_epoch;
+}
+
+/*! Brings every ready thread's recent_cpu and priority up to date with the
+    latest decay, moving threads whose priority changed to their new ready
+    list.  Ready threads do not run, so their priority can only change when
+    recent_cpu decays.
+
+    Runs as deferred work, so nothing can be scheduled until it returns, and
+    an interrupt handler can only add freshly unblocked threads, which are
+    already up to date, to the back of a ready list.  Interrupts are
+    therefore let in between threads, and turned off only while one thread
+    is updated, so that the cost of the walk, which grows with the number of
+    ready threads, is kept out of schedule() and out of interrupt latency.
+    A thread moved to a lower list is visited again there, at no cost. */
+static void ready_lists_refresh(void) {
+    int priority;
+
+    ASSERT(work_context());
+
+    for (priority = PRI_MAX; priority >= PRI_MIN; priority--) {
+        struct list *ready_list = &ready_lists[priority];
+        enum intr_level old_level = intr_disable();
+        struct list_elem *e = list_begin(ready_list);
+
+        while (e != list_end(ready_list)) {
+            struct thread *t = list_entry(e, struct thread, rdyelem);
+            e = list_next(e);
+
+            thread_catch_up_decay(t);
+            int new_priority = mlfqs_priority(t);
+            if (new_priority != t->priority) {
+                ready_list_remove(t);
+                ready_list_push(t, new_priority);
+                t->priority = new_priority;
+            }
+
+            intr_set_level(old_level);
+            intr_disable();
+        }
+        intr_set_level(old_level);
+    }
 }
 
 /*! Returns the total number of threads that are running */
@@ -556,6 +1045,11 @@ bool get_mlfqs(void) {
     return thread_mlfqs;
 }
 
+// Returns whether the completely fair scheduler is being used
+bool get_cfs(void) {
+    return thread_cfs;
+}
+
 bool is_idle_thread(struct thread *t) {
     return t == idle_thread;
 }
@@ -579,10 +1073,28 @@ static void idle(void *idle_started_ UNUSED) {
     sema_up(idle_started);
 
     for (;;) {
+        /* Zero a page left by an exited thread, or one for the page
+           allocator's stock of pre-zeroed pages, or move pages between the
+           page allocator's pools, if any of that is needed. */
+        bool busy = thread_page_scrub() || palloc_zero_refill()
+                    || palloc_rebalance();
+
         /* Let someone else run. */
         intr_disable();
         thread_block();
 
+        /* If we found work to do, there may be more, so check again
+           instead of halting.  Doing one page at a time lets any thread
+           that became ready in the meantime run first. */
+        if (busy) {
+            intr_enable();
+            continue;
+        }
+
+        /* Nothing else is ready, so in tickless mode there is no need for
+           timer interrupts until the next sleeper is due. */
+        timer_idle_enter();
+
         /* Re-enable interrupts and wait for the next one.
 
            The `sti' instruction disables interrupts until the completion of
@@ -636,6 +1148,7 @@ static void init_thread(struct thread *t, const char *name, int priority) {
     strlcpy(t->name, name, sizeof t->name);
     t->stack = (uint8_t *) t + PGSIZE;
     t->priority = priority;
+    t->eff_priority = priority;
     t->magic = THREAD_MAGIC;
 
     sema_init(&(t->sema_wait), 0);  // Thread is initially not blocked
@@ -665,19 +1178,139 @@ static void * alloc_frame(struct thread *t, size_t size) {
     thread can continue running, then it will be in the run queue.)  If the
     run queue is empty, return idle_thread. */
 static struct thread * next_thread_to_run(void) {
-    int i = PRI_MAX;
-    for (; i >= PRI_MIN; i--) {
-        struct list *ready_lst = &ready_lists[i];
-
-        if (!list_empty(ready_lst)) {
-            struct thread *next =
-                list_entry(list_pop_front(ready_lst), struct thread, rdyelem);
-            num_threads_ready--;
-            return next;
+    if (thread_cfs) {
+        if (rb_empty(&cfs_tree)) {
+            return idle_thread;
         }
+        num_threads_ready--;
+        return cfs_dequeue_min();
+    }
+
+    int priority = ready_max_priority();
+    if (priority < PRI_MIN) {
+        return idle_thread;
     }
 
-    return idle_thread;
+    struct thread *next = list_entry(list_front(&ready_lists[priority]),
+                                     struct thread, rdyelem);
+    ready_list_remove(next);
+    num_threads_ready--;
+    return next;
+}
+
+/*! Appends T to the ready list for PRIORITY and marks that list as non-empty
+    in ready_mask.  Must be called with interrupts off. */
+static void ready_list_push(struct thread *t, int priority) {
+    ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+
+    list_push_back(&ready_lists[priority], &t->rdyelem);
+    ready_mask[priority / 32] |= 1u << (priority % 32);
+    t->ready_pri = priority;
+}
+
+/*! Removes T from whichever ready list it is on, clearing that list's bit in
+    ready_mask if it became empty.  Must be called with interrupts off. */
+static void ready_list_remove(struct thread *t) {
+    int priority = t->ready_pri;
+
+    list_remove(&t->rdyelem);
+    if (list_empty(&ready_lists[priority])) {
+        ready_mask[priority / 32] &= ~(1u << (priority % 32));
+    }
+}
+
+/*! Returns the highest priority with a non-empty ready list, or PRI_MIN - 1
+    if no thread is ready.  Uses the `bsr' instruction on ready_mask (see
+    [IA32-v2a] "BSR--Bit Scan Reverse"). */
+static int ready_max_priority(void) {
+    int w;
+
+    for (w = READY_MASK_WORDS - 1; w >= 0; w--) {
+        if (ready_mask[w] != 0) {
+            uint32_t bit;
+            asm ("bsrl %1, %0" : "=r" (bit) : "rm" (ready_mask[w]));
+            return w * 32 + bit;
+        }
+    }
+
+    return PRI_MIN - 1;
+}
+
+/*! Returns T's CFS weight for its nice value. */
+static unsigned long cfs_weight(const struct thread *t) {
+    return cfs_weights[t->nice - NICE_MIN];
+}
+
+/*! Orders the CFS run queue by vruntime.  Threads with equal vruntime are
+    kept in FIFO order by rb_insert(). */
+static bool cfs_less(const struct rb_elem *a_, const struct rb_elem *b_,
+                     void *aux UNUSED) {
+    const struct thread *a = rb_entry(a_, struct thread, cfs_elem);
+    const struct thread *b = rb_entry(b_, struct thread, cfs_elem);
+
+    return a->vruntime < b->vruntime;
+}
+
+/*! Adds T to the CFS run queue.  Must be called with interrupts off. */
+static void cfs_enqueue(struct thread *t) {
+    rb_insert(&cfs_tree, &t->cfs_elem);
+    cfs_load += cfs_weight(t);
+}
+
+/*! Removes and returns the thread with the smallest vruntime from the
+    nonempty CFS run queue.  Must be called with interrupts off. */
+static struct thread *cfs_dequeue_min(void) {
+    struct thread *t = rb_entry(rb_min(&cfs_tree), struct thread, cfs_elem);
+
+    rb_remove(&cfs_tree, &t->cfs_elem);
+    cfs_load -= cfs_weight(t);
+    return t;
+}
+
+/*! Clamps the vruntime of T, which is waking up, to at most half a latency
+    period behind cfs_min_vruntime.  Sleepers get a small head start so they
+    run promptly, but cannot bank the time they slept to monopolize the CPU
+    afterwards. */
+static void cfs_place(struct thread *t) {
+    uint64_t credit = (uint64_t) CFS_LATENCY * CFS_TICK / 2;
+    uint64_t floor = cfs_min_vruntime > credit ? cfs_min_vruntime - credit : 0;
+
+    if (t->vruntime < floor) {
+        t->vruntime = floor;
+    }
+}
+
+/*! Charges T, the running thread, for one tick and advances
+    cfs_min_vruntime.  Called from the timer interrupt. */
+static void cfs_tick(struct thread *t) {
+    uint64_t min;
+
+    if (t == idle_thread) {
+        return;
+    }
+
+    t->vruntime += (uint64_t) CFS_TICK * CFS_NICE_0_WEIGHT / cfs_weight(t);
+
+    min = t->vruntime;
+    if (!rb_empty(&cfs_tree)) {
+        struct thread *left =
+            rb_entry(rb_min(&cfs_tree), struct thread, cfs_elem);
+        if (left->vruntime < min) {
+            min = left->vruntime;
+        }
+    }
+    if (min > cfs_min_vruntime) {
+        cfs_min_vruntime = min;
+    }
+}
+
+/*! Returns the number of ticks T may run before being preempted: its
+    weighted share of CFS_LATENCY among all runnable threads. */
+static unsigned cfs_slice(struct thread *t) {
+    unsigned long weight = cfs_weight(t);
+    unsigned slice = CFS_LATENCY * weight / (cfs_load + weight);
+
+    return slice > CFS_MIN_GRANULARITY ? slice : CFS_MIN_GRANULARITY;
 }
 
 /*! Completes a thread switch by activating the new thread's page tables, and,
@@ -718,7 +1351,7 @@ void thread_schedule_tail(struct thread *prev) {
     if (prev != NULL && prev->status == THREAD_DYING &&
         prev != initial_thread) {
         ASSERT(prev != cur);
-        palloc_free_page(prev);
+        thread_page_put(prev);
     }
 }
 
@@ -730,18 +1363,88 @@ void thread_schedule_tail(struct thread *prev) {
     completed. */
 static void schedule(void) {
     struct thread *cur = running_thread();
+    uint64_t start = rdtsc();
     struct thread *next = next_thread_to_run();
+    uint64_t cycles = rdtsc() - start;
     struct thread *prev = NULL;
 
     ASSERT(intr_get_level() == INTR_OFF);
     ASSERT(cur->status != THREAD_RUNNING);
     ASSERT(is_thread(next));
 
+    pick_stats.count++;
+    pick_stats.cycles += cycles;
+    if (cycles > pick_stats.max_cycles) {
+        pick_stats.max_cycles = cycles;
+    }
+
+    sched_stats_switch(cur, next);
+    trace(TRACE_SWITCH, next->tid, cur->status);
     if (cur != next)
         prev = switch_threads(cur, next);
     thread_schedule_tail(prev);
 }
 
+/*! Updates the scheduling statistics of CUR, which is giving up the CPU, and
+    of NEXT, which is about to run in its place.  CUR and NEXT may be the
+    same thread.  A switch is voluntary if CUR blocked or is exiting, and
+    involuntary if it is still ready to run. */
+static void sched_stats_switch(struct thread *cur, struct thread *next) {
+    uint64_t now = rdtsc();
+
+    cur->stats.run_cycles += now - cur->sched_stamp;
+    cur->sched_stamp = now;
+    if (cur->status == THREAD_READY) {
+        cur->sched_woken = false;
+        if (cur != next) {
+            cur->stats.involuntary_switches++;
+        }
+    }
+    else if (cur != next) {
+        cur->stats.voluntary_switches++;
+    }
+
+    /* The idle thread does not wait in the run queue. */
+    if (next != idle_thread) {
+        uint64_t delay = now - next->sched_stamp;
+
+        next->stats.wait_cycles += delay;
+        rq_delay_hist[rq_delay_bucket(delay)]++;
+        if (next->sched_woken) {
+            next->sched_woken = false;
+            next->stats.wakeups++;
+            next->stats.wakeup_cycles += delay;
+            if (delay > next->stats.max_wakeup_cycles) {
+                next->stats.max_wakeup_cycles = delay;
+            }
+        }
+        next->sched_stamp = now;
+    }
+}
+
+/*! Returns the rq_delay_hist bucket for a DELAY in cycles, using the `bsr'
+    instruction to find its log2 (see [IA32-v2a] "BSR--Bit Scan Reverse"). */
+static int rq_delay_bucket(uint64_t delay) {
+    uint32_t high = delay >> 32;
+    uint32_t low = delay;
+    uint32_t bit;
+    int bucket;
+
+    if (high != 0) {
+        asm ("bsrl %1, %0" : "=r" (bit) : "rm" (high));
+        bucket = 32 + bit + 1;
+    }
+    else if (low != 0) {
+        asm ("bsrl %1, %0" : "=r" (bit) : "rm" (low));
+        bucket = bit + 1;
+    }
+    else {
+        return 0;
+    }
+
+    return bucket < SCHED_HIST_BUCKETS ? bucket : SCHED_HIST_BUCKETS - 1;
+}
+
 /*! Returns a tid to use for a new thread. */
 static tid_t allocate_tid(void) {
     static tid_t next_tid = 1;
@@ -754,6 +1457,74 @@ static tid_t allocate_tid(void) {
     return tid;
 }
 
+/*! Returns a page for a new thread, from the thread page cache if possible,
+    or a null pointer if none is available.  Only the struct thread at the
+    bottom of the page is meaningful; init_thread() reinitializes it. */
+static struct thread *thread_page_get(void) {
+    struct thread *t = NULL;
+    enum intr_level old_level = intr_disable();
+
+    if (cache_clean_cnt > 0) {
+        t = cache_clean[--cache_clean_cnt];
+    }
+    else if (cache_dirty_cnt > 0) {
+        t = cache_dirty[--cache_dirty_cnt];
+    }
+
+    if (t != NULL) {
+        cache_hits++;
+    }
+    else {
+        cache_misses++;
+    }
+    intr_set_level(old_level);
+
+    if (t == NULL) {
+        t = palloc_get_page(0);
+    }
+    return t;
+}
+
+/*! Returns the page of T, a dead thread, to the thread page cache, or to
+    the page allocator if the cache is full.  Called with interrupts off. */
+static void thread_page_put(struct thread *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (cache_clean_cnt + cache_dirty_cnt + cache_scrub_cnt
+        < THREAD_CACHE_SIZE) {
+        cache_dirty[cache_dirty_cnt++] = t;
+    }
+    else {
+        palloc_free_page(t);
+    }
+}
+
+/*! Zeroes one dirty page in the thread page cache, if there is one, and
+    returns true if there was.  Called by the idle thread with interrupts on;
+    the page is out of the cache while it is being zeroed, but still counts
+    against its size, so that thread_page_put() leaves room to put it back. */
+static bool thread_page_scrub(void) {
+    enum intr_level old_level = intr_disable();
+    void *page = NULL;
+
+    if (cache_dirty_cnt > 0) {
+        page = cache_dirty[--cache_dirty_cnt];
+        cache_scrub_cnt++;
+    }
+    intr_set_level(old_level);
+
+    if (page == NULL) {
+        return false;
+    }
+    memset(page, 0, PGSIZE);
+
+    old_level = intr_disable();
+    cache_scrub_cnt--;
+    cache_clean[cache_clean_cnt++] = page;
+    intr_set_level(old_level);
+    return true;
+}
+
 /*! Offset of `stack' member within `struct thread'.
     Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof(struct thread, stack);
@@ -8,7 +8,10 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
+#include <sched-stats.h>
 #include <stdint.h>
+#include "malloc.h"
 #include "synch.h"
 #include "lib/kernel/fixed_point.h"
 
@@ -101,13 +104,22 @@ struct thread {
     enum thread_status status;          /*!< Thread state. */
     char name[16];                      /*!< Name (for debugging purposes). */
     uint8_t *stack;                     /*!< Saved stack pointer. */
-    int priority;                       /*!< Priority (Possible donated). */
+    int priority;                       /*!< Base priority. */
+    int eff_priority;                   /*!< Priority including donations. */
 
     int nice;                           /*!< The threads nice value. */
     fp recent_cpu;                      /*!< The threads recent_cpu. */
+    unsigned recent_cpu_epoch;          /*!< Number of decays recent_cpu has had. */
 
     struct list_elem allelem;           /*!< List element for all threads list. */
     struct list_elem rdyelem;           /*!< List element for the ready lists. */
+    int ready_pri;                      /*!< Index of the ready list holding rdyelem. */
+    struct rb_elem cfs_elem;            /*!< Tree element for the CFS run queue. */
+    uint64_t vruntime;                  /*!< Weighted run time, for CFS. */
+
+    uint64_t sched_stamp;               /*!< TSC when last run or made ready. */
+    bool sched_woken;                   /*!< Made ready by thread_unblock()? */
+    struct sched_stats stats;           /*!< Scheduling statistics. */
     struct list_elem waitelem;          /*!< List element for waiting list. */
     /**@}*/
 
@@ -116,12 +128,21 @@ struct thread {
     int64_t ticks_awake;                /*!< Tick time to wake up at. */
 
     struct semaphore sema_wait;         /*!< Semaphore for thread while sleeping. */
-    struct list_elem semaelem;          /*!< List element for the list of semaphore waiters. */
+    struct rb_elem semaelem;            /*!< Element in a semaphore's waiters. */
+    struct semaphore *sema_waiton;      /*!< The semaphore the thread is blocked on. */
+    struct condition *cond_waiton;      /*!< The condition the thread waits on. */
+    struct rb_elem *cond_elem;          /*!< Its element in cond_waiton's waiters. */
+    int wait_priority;                  /*!< Priority it is queued at in sema_waiton. */
 
     struct list locks;                  /*!< List of locks the thread has acquired. */
     struct lock *lock_waiton;           /*!< The lock the current thread is waiting on. */
     /**@}*/
 
+    /*! Owned by malloc.c. */
+    /**@{*/
+    struct malloc_mags mags;            /*!< Caches of free blocks. */
+    /**@}*/
+
 #ifdef USERPROG
     /*! Owned by userprog/process.c. */
     /**@{*/
@@ -135,16 +156,31 @@ struct thread {
     /**@}*/
 };
 
+/*! Time schedule() spends choosing the next thread to run. */
+struct thread_pick_stats {
+    int64_t count;              /*!< Number of scheduling decisions. */
+    uint64_t cycles;            /*!< Total CPU cycles spent making them. */
+    uint64_t max_cycles;        /*!< Longest single decision, in cycles. */
+};
+
 /*! If false (default), use round-robin scheduler.
     If true, use multi-level feedback queue scheduler.
     Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/*! If true, use the completely fair scheduler instead of either of the
+    above.  Controlled by kernel command-line option "-sched=cfs". */
+extern bool thread_cfs;
+
 void thread_init(void);
 void thread_start(void);
 
 void thread_tick(void);
 void thread_print_stats(void);
+bool thread_get_sched_stats(tid_t, struct sched_stats *,
+                            unsigned hist[SCHED_HIST_BUCKETS]);
+void thread_get_pick_stats(struct thread_pick_stats *);
+void thread_reset_pick_stats(void);
 
 typedef void thread_func(void *aux);
 tid_t thread_create(const char *name, int priority, thread_func *, void *);
@@ -161,6 +197,7 @@ void thread_yield(void);
 
 void thread_sleep(struct thread *t);
 void threads_wake(int64_t ticks_now);
+int64_t threads_next_wake(int64_t limit);
 
 /*! Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func(struct thread *t, void *aux);
@@ -169,6 +206,7 @@ void thread_foreach(thread_action_func *, void *);
 
 int thread_get_priority(void);
 int thread_get_priority_t(struct thread *t);
+void thread_update_priority(struct thread *t);
 void thread_set_priority(int);
 
 void thread_reschedule(struct thread *t, int priority);
@@ -180,6 +218,7 @@ int thread_get_load_avg(void);
 bool is_idle_thread(struct thread *t);
 
 void thread_calculate_priority(struct thread *t);
+void thread_mlfqs_decay(fp coef);
 
 // The number of threads running or ready to run. Not including the
 // idle thread
@@ -188,6 +227,9 @@ int threads_ready(void);
 // Returns whether the multi-level feedback queue scheduler is being used
 bool get_mlfqs(void);
 
+// Returns whether the completely fair scheduler is being used
+bool get_cfs(void);
+
 struct list *get_all_list(void);
 
 #endif /* threads/thread.h */
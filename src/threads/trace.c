@@ -0,0 +1,108 @@
+/*! \file trace.c
+ *
+ * A ring buffer of kernel events, for building timelines of scheduling,
+ * interrupts, and I/O without the perturbation of printf().
+ *
+ * Each call to trace() costs a branch when tracing is disabled and a
+ * 24-byte store with interrupts off when it is enabled.  Once the ring
+ * fills, the oldest records are overwritten.  At shutdown, trace_dump()
+ * writes the records to the serial port, one line of hex per record,
+ * between "TRACE BEGIN" and "TRACE END" lines.  utils/pintos-trace turns
+ * that dump into Chrome trace_event JSON for chrome://tracing or Perfetto.
+ */
+
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <list.h>
+#include <stdio.h>
+#include "devices/serial.h"
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/*! Number of records in the ring.  Must be a power of 2. */
+#define TRACE_RECORDS 4096
+
+/*! Tracer state.
+    @{ */
+bool trace_enabled;
+static struct trace_record ring[TRACE_RECORDS];
+static uint32_t ring_head;              /*!< Number of records ever written. */
+/*! @} */
+
+static void dump_printf(const char *format, ...) PRINTF_FORMAT(1, 2);
+
+/*! Returns the tid of the thread whose stack we are on.  Unlike
+    thread_current(), this works in the middle of a context switch. */
+static tid_t trace_tid(void) {
+    uint32_t *esp;
+
+    asm ("mov %%esp, %0" : "=g" (esp));
+    return ((struct thread *) pg_round_down(esp))->tid;
+}
+
+/*! Records EVENT with arguments ARG0 and ARG1.  Use trace() instead, which
+    skips the call when tracing is disabled. */
+void trace_record(enum trace_event event, uint32_t arg0, uint32_t arg1) {
+    enum intr_level old_level = intr_disable();
+    struct trace_record *r = &ring[ring_head++ % TRACE_RECORDS];
+
+    r->tsc = rdtsc();
+    r->tid = trace_tid();
+    r->event = event;
+    r->arg0 = arg0;
+    r->arg1 = arg1;
+    intr_set_level(old_level);
+}
+
+/*! Writes the trace ring, oldest record first, to the serial port only, so
+    that a long dump does not scroll the VGA console.  Does nothing if no
+    event was ever recorded.  Tracing is stopped first.
+
+    The dump starts with "TRACE BEGIN COUNT CYCLES-PER-TICK TIMER-FREQ",
+    followed by one "TRACE THREAD TID NAME" line for each thread still
+    alive, then COUNT lines of "TSC TID EVENT ARG0 ARG1" in hex, and ends
+    with "TRACE END". */
+void trace_dump(void) {
+    struct list_elem *e;
+    uint32_t first, i;
+
+    trace_enabled = false;
+    if (ring_head == 0)
+        return;
+
+    first = ring_head > TRACE_RECORDS ? ring_head - TRACE_RECORDS : 0;
+
+    dump_printf("TRACE BEGIN %"PRIu32" %"PRIu64" %d\n",
+                ring_head - first, timer_tsc_hz / TIMER_FREQ, TIMER_FREQ);
+    for (e = list_begin(get_all_list()); e != list_end(get_all_list());
+         e = list_next(e)) {
+        struct thread *t = list_entry(e, struct thread, allelem);
+        dump_printf("TRACE THREAD %d %s\n", t->tid, t->name);
+    }
+    for (i = first; i != ring_head; i++) {
+        const struct trace_record *r = &ring[i % TRACE_RECORDS];
+        dump_printf("%"PRIx64" %"PRIx32" %"PRIx32" %"PRIx32" %"PRIx32"\n",
+                    r->tsc, (uint32_t) r->tid, r->event, r->arg0, r->arg1);
+    }
+    dump_printf("TRACE END\n");
+    serial_flush();
+}
+
+/*! Formats FORMAT like printf() and writes the result to the serial port
+    alone. */
+static void dump_printf(const char *format, ...) {
+    char buf[64];
+    const char *p;
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(buf, sizeof buf, format, args);
+    va_end(args);
+
+    for (p = buf; *p != '\0'; p++)
+        serial_putc(*p);
+}
@@ -0,0 +1,51 @@
+/*! \file trace.h
+ *
+ * Declarations for the kernel event tracer.
+ */
+
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*! Traced events.  The meaning of each event's two arguments is given
+    after it.  utils/pintos-trace knows these numbers, so only ever add new
+    events at the end. */
+enum trace_event {
+    TRACE_SWITCH = 1,           /*!< Switch: next tid, old thread's status. */
+    TRACE_BLOCK,                /*!< Thread blocks: none. */
+    TRACE_UNBLOCK,              /*!< Thread unblocked: its tid. */
+    TRACE_SEMA_DOWN,            /*!< sema_down(): semaphore, value. */
+    TRACE_SEMA_UP,              /*!< sema_up(): semaphore, woken tid or 0. */
+    TRACE_INTR_ENTER,           /*!< Interrupt entry: vector. */
+    TRACE_INTR_EXIT,            /*!< Interrupt exit: vector. */
+    TRACE_BLOCK_READ,           /*!< block_read() starts: sector, block type. */
+    TRACE_BLOCK_WRITE,          /*!< block_write() starts: sector, block type. */
+    TRACE_BLOCK_DONE,           /*!< Block read or write done: sector. */
+    TRACE_PAGE_FAULT            /*!< Page fault: address, error code. */
+};
+
+/*! A single trace record. */
+struct trace_record {
+    uint64_t tsc;               /*!< Time stamp counter at the event. */
+    int32_t tid;                /*!< Running thread. */
+    uint32_t event;             /*!< An enum trace_event. */
+    uint32_t arg0, arg1;        /*!< Event-specific arguments. */
+};
+
+/*! If true, events are recorded.  Set by kernel command-line option
+    "-trace", and may be changed at any time. */
+extern bool trace_enabled;
+
+void trace_record(enum trace_event, uint32_t arg0, uint32_t arg1);
+void trace_dump(void);
+
+/*! Records EVENT with arguments ARG0 and ARG1, if tracing is enabled. */
+static inline void trace(enum trace_event event, uint32_t arg0,
+                         uint32_t arg1) {
+    if (trace_enabled)
+        trace_record(event, arg0, arg1);
+}
+
+#endif /* threads/trace.h */
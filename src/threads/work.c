@@ -0,0 +1,103 @@
+/*! \file work.c
+ *
+ * Deferred work, the bottom half of external interrupt handling.
+ *
+ * An external interrupt handler runs with interrupts off, so everything
+ * it does adds to the latency of every other interrupt.  Instead of doing
+ * slow bookkeeping itself, a handler can queue a struct work and return.
+ * intr_handler() runs the queued work as the interrupt returns, after the
+ * PIC has been acknowledged, with interrupts turned back on between and
+ * during work items.  Higher-priority queues are drained first.
+ *
+ * Work runs on the interrupted thread's stack, in the interrupted
+ * thread's name, so a work function must not sleep and must not yield.
+ * Waking a higher-priority thread instead asks for a yield on interrupt
+ * return, just as it would from the handler itself.  An interrupt that
+ * arrives while work is running does not start another round of work;
+ * the round already in progress picks up anything it queues.
+ *
+ * Queuing work that is already pending does nothing, so a work function
+ * must tolerate covering several of its triggering events at once.
+ */
+
+#include "threads/work.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+
+/*! One list of pending work per priority. */
+static struct list queues[WORK_PRI_CNT] = {
+    LIST_INITIALIZER(queues[WORK_HIGH]),
+    LIST_INITIALIZER(queues[WORK_NORMAL])
+};
+
+/*! Is work_run() running work? */
+static bool running;
+
+/*! Initializes W to run FUNC(AUX) on queue PRIORITY when queued. */
+void work_init(struct work *w, work_func *func, void *aux,
+               enum work_priority priority) {
+    ASSERT(w != NULL);
+    ASSERT(func != NULL);
+    ASSERT(priority < WORK_PRI_CNT);
+
+    w->func = func;
+    w->aux = aux;
+    w->priority = priority;
+    w->pending = false;
+}
+
+/*! Queues W to run when the current external interrupt returns, or when
+    the next one does if there is no current one.  Returns true if W was
+    queued, false if it was already pending.  May be called from an
+    interrupt handler or with interrupts in either state. */
+bool work_queue(struct work *w) {
+    enum intr_level old_level = intr_disable();
+    bool queued = !w->pending;
+
+    if (queued) {
+        w->pending = true;
+        list_push_back(&queues[w->priority], &w->elem);
+    }
+    intr_set_level(old_level);
+    return queued;
+}
+
+/*! Runs pending work, highest priority first, until none is left.  Called
+    by intr_handler() with interrupts off, once the interrupt has been
+    acknowledged; interrupts are off again on return.  Does nothing if
+    work is already running further down the stack. */
+void work_run(void) {
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(!intr_context());
+
+    if (running)
+        return;
+
+    running = true;
+    for (;;) {
+        struct work *w = NULL;
+        int priority;
+
+        for (priority = 0; priority < WORK_PRI_CNT; priority++) {
+            if (!list_empty(&queues[priority])) {
+                w = list_entry(list_pop_front(&queues[priority]),
+                               struct work, elem);
+                break;
+            }
+        }
+        if (w == NULL)
+            break;
+
+        w->pending = false;
+        intr_enable();
+        w->func(w->aux);
+        intr_disable();
+    }
+    running = false;
+}
+
+/*! Returns true while deferred work is running.  Like an interrupt
+    handler, deferred work must not sleep or yield the CPU. */
+bool work_context(void) {
+    return running;
+}
@@ -0,0 +1,38 @@
+/*! \file work.h
+ *
+ * Declarations for deferring work out of external interrupt handlers.
+ */
+
+#ifndef THREADS_WORK_H
+#define THREADS_WORK_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/*! Work queues, in the order they are serviced. */
+enum work_priority {
+    WORK_HIGH,                  /*!< Timekeeping and wake-ups. */
+    WORK_NORMAL,                /*!< Everything else. */
+    WORK_PRI_CNT                /*!< Number of work queues. */
+};
+
+/*! A function to run as deferred work, given auxiliary data AUX. */
+typedef void work_func(void *aux);
+
+/*! An item of deferred work.  The owner embeds one in a long-lived
+    structure, initializes it once with work_init(), and queues it with
+    work_queue() as often as needed. */
+struct work {
+    struct list_elem elem;      /*!< Element in its work queue. */
+    work_func *func;            /*!< Function to run. */
+    void *aux;                  /*!< Argument for FUNC. */
+    enum work_priority priority; /*!< Queue to use. */
+    bool pending;               /*!< Queued but not yet started? */
+};
+
+void work_init(struct work *, work_func *, void *aux, enum work_priority);
+bool work_queue(struct work *);
+void work_run(void);
+bool work_context(void);
+
+#endif /* threads/work.h */
@@ -4,6 +4,7 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 
 /*! Number of page faults processed. */
 static long long page_fault_cnt;
@@ -121,6 +122,7 @@ static void page_fault(struct intr_frame *f) {
        See [IA32-v2a] "MOV--Move to/from Control Registers" and
        [IA32-v3a] 5.15 "Interrupt 14--Page Fault Exception (#PF)". */
     asm ("movl %%cr2, %0" : "=r" (fault_addr));
+    trace(TRACE_PAGE_FAULT, (uint32_t) fault_addr, f->error_code);
 
     /* Turn interrupts back on (they were only off so that we could
        be assured of reading CR2 before it changed). */
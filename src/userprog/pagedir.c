@@ -123,6 +123,19 @@ void * pagedir_get_page(uint32_t *pd, const void *uaddr) {
         return NULL;
 }
 
+/*! Returns true if user virtual address UADDR is mapped in PD by a PTE that
+    lets user code write to it.  The kernel runs with CR0.WP clear, so it
+    must check this itself before writing to a user buffer. */
+bool pagedir_is_writable(uint32_t *pd, const void *uaddr) {
+    uint32_t *pte;
+
+    ASSERT(is_user_vaddr(uaddr));
+
+    pte = lookup_page(pd, uaddr, false);
+    return (pte != NULL
+            && (*pte & (PTE_P | PTE_U | PTE_W)) == (PTE_P | PTE_U | PTE_W));
+}
+
 /*! Marks user virtual page UPAGE "not present" in page directory PD.  Later
     accesses to the page will fault.  Other bits in the page table entry are
     preserved.
@@ -194,7 +207,9 @@ void pagedir_activate(uint32_t *pd) {
     /* Store the physical address of the page directory into CR3 aka PDBR
        (page directory base register).  This activates our new page tables
        immediately.  See [IA32-v2a] "MOV--Move to/from Control Registers" and
-       [IA32-v3a] 3.7.5 "Base Address of the Page Directory". */
+       [IA32-v3a] 3.7.5 "Base Address of the Page Directory".  This flushes
+       the TLB, except for the kernel's global mappings, which every page
+       directory shares. */
     asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
 }
 
@@ -8,9 +8,11 @@
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
+#include "devices/timer.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
@@ -21,6 +23,14 @@
 static thread_func start_process NO_RETURN;
 static bool load(const char *cmdline, void (**eip)(void), void **esp);
 
+/*! Time taken by successful calls to load(), for statistics.  Updated with
+    interrupts off.
+    @{ */
+static long long load_cnt;
+static uint64_t load_cycles;
+static uint64_t load_max_cycles;
+/*! @} */
+
 /*! Starts a new thread running a user program loaded from FILENAME.  The new
     thread may be scheduled (and may even exit) before process_execute()
     returns.  Returns the new process's thread id, or TID_ERROR if the thread
@@ -47,6 +57,8 @@ tid_t process_execute(const char *file_name) {
 static void start_process(void *file_name_) {
     char *file_name = file_name_;
     struct intr_frame if_;
+    enum intr_level old_level;
+    uint64_t start, cycles;
     bool success;
 
     /* Initialize interrupt frame and load executable. */
@@ -54,7 +66,18 @@ static void start_process(void *file_name_) {
     if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
     if_.cs = SEL_UCSEG;
     if_.eflags = FLAG_IF | FLAG_MBS;
+    start = rdtsc();
     success = load(file_name, &if_.eip, &if_.esp);
+    cycles = rdtsc() - start;
+
+    if (success) {
+        old_level = intr_disable();
+        load_cnt++;
+        load_cycles += cycles;
+        if (cycles > load_max_cycles)
+            load_max_cycles = cycles;
+        intr_set_level(old_level);
+    }
 
     /* If load failed, quit. */
     palloc_free_page(file_name);
@@ -105,6 +128,13 @@ void process_exit(void) {
     }
 }
 
+/*! Prints statistics on how long it took to load user programs. */
+void process_print_stats(void) {
+    printf("Process: %lld loads, %lld ns average, %lld ns worst\n", load_cnt,
+           clock_cycles_to_ns(load_cnt ? load_cycles / load_cnt : 0),
+           clock_cycles_to_ns(load_max_cycles));
+}
+
 /*! Sets up the CPU for running user code in the current thread.
     This function is called on every context switch. */
 void process_activate(void) {
@@ -368,8 +398,9 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
         size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
         size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-        /* Get a page of memory. */
-        uint8_t *kpage = palloc_get_page(PAL_USER);
+        /* Get a page of memory, already zeroed if it is all zeros. */
+        uint8_t *kpage = palloc_get_page(page_read_bytes == 0
+                                         ? PAL_USER | PAL_ZERO : PAL_USER);
         if (kpage == NULL)
             return false;
 
@@ -378,7 +409,8 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
             palloc_free_page(kpage);
             return false;
         }
-        memset(kpage + page_read_bytes, 0, page_zero_bytes);
+        if (page_read_bytes > 0)
+            memset(kpage + page_read_bytes, 0, page_zero_bytes);
 
         /* Add the page to the process's address space. */
         if (!install_page(upage, kpage, writable)) {
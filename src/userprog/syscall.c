@@ -1,17 +1,85 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include <sched-stats.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
 
 static void syscall_handler(struct intr_frame *);
+static bool user_range_ok(const void *uaddr, size_t size, bool write);
+static bool sys_sched_stats(tid_t tid, struct sched_stats *ustats,
+                            unsigned *uhist);
 
 void syscall_init(void) {
     intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
-static void syscall_handler(struct intr_frame *f UNUSED) {
+static void syscall_handler(struct intr_frame *f) {
+    uint32_t *args = f->esp;
+
+    if (user_range_ok(args, sizeof *args, false)) {
+        switch (args[0]) {
+        case SYS_SCHED_STATS:
+            if (!user_range_ok(args + 1, 3 * sizeof *args, false)) {
+                break;
+            }
+            f->eax = sys_sched_stats((tid_t) args[1],
+                                     (struct sched_stats *) args[2],
+                                     (unsigned *) args[3]);
+            return;
+        }
+    }
+
     printf("system call!\n");
     thread_exit();
 }
 
+/*! Returns true if the SIZE bytes at user address UADDR are all mapped in
+    the running process's page directory, and, if WRITE, are all writable by
+    the process. */
+static bool user_range_ok(const void *uaddr, size_t size, bool write) {
+    const uint8_t *p = uaddr;
+    const uint8_t *end = p + size;
+    uint32_t *pd = thread_current()->pagedir;
+
+    if (size == 0) {
+        return true;
+    }
+    if (end < p || !is_user_vaddr(end - 1)) {
+        return false;
+    }
+    for (p = pg_round_down(p); p < end; p += PGSIZE) {
+        if (write ? !pagedir_is_writable(pd, p)
+                  : pagedir_get_page(pd, p) == NULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*! sched_stats() system call: copies the scheduling statistics of thread TID
+    to USTATS and, unless UHIST is null, the run queue delay histogram to
+    UHIST.  Kills the process if either buffer is not mapped writable, so
+    that it cannot have the kernel overwrite its read-only pages. */
+static bool sys_sched_stats(tid_t tid, struct sched_stats *ustats,
+                            unsigned *uhist) {
+    struct sched_stats stats;
+    unsigned hist[SCHED_HIST_BUCKETS];
+
+    if (!user_range_ok(ustats, sizeof *ustats, true) ||
+        (uhist != NULL && !user_range_ok(uhist, sizeof hist, true))) {
+        thread_exit();
+    }
+
+    if (!thread_get_sched_stats(tid, &stats, uhist != NULL ? hist : NULL)) {
+        return false;
+    }
+    memcpy(ustats, &stats, sizeof stats);
+    if (uhist != NULL) {
+        memcpy(uhist, hist, sizeof hist);
+    }
+    return true;
+}